@@ -39,7 +39,7 @@ public class MainActivity extends Activity {
         setContentView(R.layout.main);
 
         try {
-            boolean retInit = yolov5Detect.init(AssetHelper.assetFilePath(this, DefaultModel.YOLOV5S_FP.name),
+            boolean retInit = yolov5Detect.init(AssetHelper.modelFilePath(this, DefaultModel.YOLOV5S_FP.name),
                     AssetHelper.assetFilePath(this, "coco_80_labels_list.txt"), false);
             if (!retInit) {
                 Log.e(TAG, "YoloV5Detect Init failed");
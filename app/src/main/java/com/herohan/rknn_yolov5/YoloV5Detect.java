@@ -11,5 +11,68 @@ public class YoloV5Detect {
 
     public native boolean detect(Bitmap srtBitmap);
 
+    /**
+     * Record the raw detection head outputs of every following detect() call,
+     * for replaying post-processing off-device.
+     */
+    public native boolean startTensorRecord(String recordPath);
+
+    /**
+     * @return the number of recorded frames
+     */
+    public native int stopTensorRecord();
+
+    /**
+     * Split the CPU letterbox fallback into this many horizontal bands run on the
+     * worker threads (default: one per worker). Per-band times are logged per frame;
+     * bands <= 0 are ignored.
+     */
+    public native void setPreprocessBands(int bands);
+
+    /** Every candidate against every kept box, the default */
+    public static final int NMS_ENGINE_EXHAUSTIVE = 0;
+    /** Kept boxes bucketed in a uniform grid over the model input */
+    public static final int NMS_ENGINE_GRID = 1;
+
+    /**
+     * Select the NMS implementation of the following detect() calls, after init().
+     * Values other than the NMS_ENGINE_ constants are ignored.
+     */
+    public native void setNmsEngine(int engine);
+
+    /** Defaults of setDetectOptions() */
+    public static final float DEFAULT_CONF_THRESHOLD = 0.25f;
+    public static final float DEFAULT_NMS_THRESHOLD = 0.45f;
+    /** Also the most results a detect() call returns */
+    public static final int DEFAULT_MAX_DETECTIONS = 128;
+    public static final int DEFAULT_PRE_NMS_TOP_K = 1024;
+
+    /**
+     * Thresholds and limits of the following detect() calls. A preNmsTopK <= 0 hands
+     * every candidate to NMS; classAllowlist holds the class ids decoded, each box takes
+     * its best allowed class. null falls back to setDecodeClasses().
+     */
+    public native void setDetectOptions(float confThreshold, float nmsThreshold, int maxDetections,
+                                        int preNmsTopK, int[] classAllowlist);
+
+    /**
+     * Decode only these class ids in the detect() calls without an allowlist of their own,
+     * after init(); the other class channels are not read. null for every class.
+     */
+    public native boolean setDecodeClasses(int[] classIds);
+
+    /** NHWC for int8 outputs, the model layout for float ones, the default */
+    public static final int OUTPUT_LAYOUT_AUTO = 0;
+    /** The model layout */
+    public static final int OUTPUT_LAYOUT_NCHW = 1;
+    /** NHWC whenever the runtime has it */
+    public static final int OUTPUT_LAYOUT_NHWC = 2;
+
+    /**
+     * Select the output layout the following zero-copy init() calls ask the runtime for.
+     * Values other than the OUTPUT_LAYOUT_ constants are ignored.
+     */
+    public native void setZeroCopyOutputLayout(int layout);
+
     public native boolean release();
 }
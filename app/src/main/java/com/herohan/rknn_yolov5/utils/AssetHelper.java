@@ -7,6 +7,7 @@ import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.io.OutputStream;
+import java.util.Arrays;
 
 public class AssetHelper {
     public static String assetFilePath(Context context, String assetName) throws IOException {
@@ -27,4 +28,16 @@ public class AssetHelper {
             return file.getAbsolutePath();
         }
     }
+
+    /**
+     * Copy a model asset like assetFilePath, along with its decode config (same name with a
+     * .cfg extension) when the assets ship one, the native side reads it next to the model.
+     */
+    public static String modelFilePath(Context context, String modelAssetName) throws IOException {
+        String config = modelAssetName.replaceFirst("\\.[^.]*$", "") + ".cfg";
+        if (Arrays.asList(context.getAssets().list("")).contains(config)) {
+            assetFilePath(context, config);
+        }
+        return assetFilePath(context, modelAssetName);
+    }
 }
@@ -0,0 +1,44 @@
+// Host stand-in for libturbojpeg, linked only when no system libturbojpeg is
+// found. Every entry point fails cleanly so read_image()/write_image() report
+// an error instead of the host build failing to link.
+
+#include <stdlib.h>
+
+#include "turbojpeg.h"
+
+static char stub_error[] = "turbojpeg is not available in this host build";
+
+tjhandle tjInitCompress(void) { return NULL; }
+
+tjhandle tjInitDecompress(void) { return NULL; }
+
+int tjCompress2(tjhandle handle, const unsigned char *srcBuf, int width, int pitch, int height,
+                int pixelFormat, unsigned char **jpegBuf, unsigned long *jpegSize,
+                int jpegSubsamp, int jpegQual, int flags)
+{
+    if (jpegSize != NULL) {
+        *jpegSize = 0;
+    }
+    return -1;
+}
+
+int tjDecompressHeader3(tjhandle handle, const unsigned char *jpegBuf, unsigned long jpegSize,
+                        int *width, int *height, int *jpegSubsamp, int *jpegColorspace)
+{
+    return -1;
+}
+
+int tjDecompress2(tjhandle handle, const unsigned char *jpegBuf, unsigned long jpegSize,
+                  unsigned char *dstBuf, int width, int pitch, int height, int pixelFormat,
+                  int flags)
+{
+    return -1;
+}
+
+int tjDestroy(tjhandle handle) { return 0; }
+
+void tjFree(unsigned char *buffer) { free(buffer); }
+
+int tjGetErrorCode(tjhandle handle) { return TJERR_FATAL; }
+
+char *tjGetErrorStr(void) { return stub_error; }
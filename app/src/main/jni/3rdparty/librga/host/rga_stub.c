@@ -0,0 +1,75 @@
+// Host stand-in for librga. There is no RGA block off-device, so buffer import
+// and every job report IM_STATUS_NOT_SUPPORTED and convert_image() takes the
+// CPU fallback path, which is the path we want to measure on the host.
+
+#include <string.h>
+
+#include "im2d.h"
+
+rga_buffer_handle_t importbuffer_fd(int fd, im_handle_param_t *param) { return 0; }
+
+rga_buffer_handle_t importbuffer_virtualaddr(void *va, im_handle_param_t *param) { return 0; }
+
+rga_buffer_handle_t importbuffer_physicaladdr(uint64_t pa, im_handle_param_t *param) { return 0; }
+
+IM_STATUS releasebuffer_handle(rga_buffer_handle_t handle) { return IM_STATUS_SUCCESS; }
+
+static rga_buffer_t stub_buffer(int width, int height, int wstride, int hstride, int format)
+{
+    rga_buffer_t buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.width = width;
+    buf.height = height;
+    buf.wstride = wstride;
+    buf.hstride = hstride;
+    buf.format = format;
+    return buf;
+}
+
+rga_buffer_t wrapbuffer_handle_t(rga_buffer_handle_t handle, int width, int height, int wstride,
+                                 int hstride, int format)
+{
+    rga_buffer_t buf = stub_buffer(width, height, wstride, hstride, format);
+    buf.handle = handle;
+    return buf;
+}
+
+rga_buffer_t wrapbuffer_virtualaddr_t(void *vir_addr, int width, int height, int wstride,
+                                      int hstride, int format)
+{
+    rga_buffer_t buf = stub_buffer(width, height, wstride, hstride, format);
+    buf.vir_addr = vir_addr;
+    return buf;
+}
+
+rga_buffer_t wrapbuffer_physicaladdr_t(void *phy_addr, int width, int height, int wstride,
+                                       int hstride, int format)
+{
+    rga_buffer_t buf = stub_buffer(width, height, wstride, hstride, format);
+    buf.phy_addr = phy_addr;
+    return buf;
+}
+
+rga_buffer_t wrapbuffer_fd_t(int fd, int width, int height, int wstride, int hstride, int format)
+{
+    rga_buffer_t buf = stub_buffer(width, height, wstride, hstride, format);
+    buf.fd = fd;
+    return buf;
+}
+
+IM_STATUS imfill_t(rga_buffer_t dst, im_rect rect, int color, int sync)
+{
+    return IM_STATUS_NOT_SUPPORTED;
+}
+
+IM_STATUS improcess(rga_buffer_t src, rga_buffer_t dst, rga_buffer_t pat,
+                    im_rect srect, im_rect drect, im_rect prect, int usage)
+{
+    return IM_STATUS_NOT_SUPPORTED;
+}
+
+const char *imStrError_t(IM_STATUS status)
+{
+    return status == IM_STATUS_NOT_SUPPORTED ? "RGA is not available in this host build"
+                                             : "unknown RGA error";
+}
@@ -0,0 +1,774 @@
+// Host stand-in for librknnrt.so.
+//
+// Implements the subset of rknn_api.h used by the demo against a synthetic YOLOv5
+// or YOLOv8 model, so the CPU side of the pipeline (letterbox, decode, NMS, drawing) can be
+// built and profiled on a Linux machine without an NPU. rknn_run() does no
+// inference: it publishes either a deterministic synthetic scene or the tensors
+// handed to rknn_stub_set_outputs().
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Float16.h"
+#include "rknn_stub.h"
+
+namespace {
+
+const int kAnchorPerBranch = 3;
+const int kBranchNum = 3;
+const int kStrides[kBranchNum] = {8, 16, 32};
+const int kAnchors[kBranchNum][6] = {{10, 13, 16, 30, 33, 23},
+                                     {30, 61, 62, 45, 59, 119},
+                                     {116, 90, 156, 198, 373, 326}};
+const int32_t kQuantZp = -128;
+const float kQuantScale = 1.0f / 255.0f;
+// YOLOv8 box bins: 16 per side, logits in [-12.8, 12.7]
+const int kDflLen = 16;
+const int32_t kDflQuantZp = 0;
+const float kDflQuantScale = 0.1f;
+
+struct StubOutput {
+    rknn_tensor_attr attr;
+    int anchors;                    // anchors per cell, 1 for the DFL branches
+    std::vector<float> values;      // logical scene, same layout as attr
+    std::vector<uint8_t> native;    // values encoded as attr.type
+    std::vector<float> as_float;    // scratch for want_float
+    rknn_tensor_mem *io_mem;
+    rknn_tensor_type io_type;
+    rknn_tensor_format io_fmt;
+};
+
+struct StubContext {
+    rknn_stub_config_t config;
+    rknn_tensor_attr input_attr;
+    std::vector<uint8_t> input;
+    rknn_tensor_mem *input_mem;
+    std::vector<StubOutput> outputs;
+};
+
+rknn_stub_config_t g_config;
+bool g_config_set = false;
+
+uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+float random_range(uint32_t *state, float lo, float hi) {
+    return lo + (hi - lo) * (float) (next_random(state) & 0xffffff) / (float) 0xffffff;
+}
+
+float clamp01(float v) {
+    return v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+}
+
+int type_bytes(rknn_tensor_type type) {
+    switch (type) {
+        case RKNN_TENSOR_FLOAT32:
+            return 4;
+        case RKNN_TENSOR_FLOAT16:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+void parse_stub_model(const char *model, uint32_t size, rknn_stub_config_t *config) {
+    std::string text(model + 8, size - 8);
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find_first_of(" \t\r\n", pos);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string token = text.substr(pos, end - pos);
+        pos = end + 1;
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = token.substr(0, eq);
+        std::string value = token.substr(eq + 1);
+        int n = atoi(value.c_str());
+        if (key == "width") {
+            config->width = n;
+        } else if (key == "height") {
+            config->height = n;
+        } else if (key == "classes") {
+            config->num_classes = n;
+        } else if (key == "objects") {
+            config->num_objects = n;
+        } else if (key == "w_stride") {
+            config->input_w_stride = n;
+        } else if (key == "seed") {
+            config->seed = (uint32_t) n;
+        } else if (key == "type") {
+            config->output_type = value == "fp32" ? RKNN_TENSOR_FLOAT32 :
+                                  value == "fp16" ? RKNN_TENSOR_FLOAT16 : RKNN_TENSOR_INT8;
+        } else if (key == "fmt") {
+            config->output_fmt = value == "nhwc" ? RKNN_TENSOR_NHWC : RKNN_TENSOR_NCHW;
+        } else if (key == "heads") {
+            config->heads = value == "yolov8" ? RKNN_STUB_HEADS_DFL : RKNN_STUB_HEADS_ANCHOR;
+        } else if (key == "score_sum") {
+            config->score_sum = n;
+        } else if (key == "reverse_outputs") {
+            config->reverse_outputs = n;
+        } else if (key == "custom") {
+            snprintf(config->custom_string, sizeof(config->custom_string), "%s", value.c_str());
+        }
+    }
+}
+
+size_t layout_index(rknn_tensor_format fmt, int grid_h, int grid_w, int anchors, int prop_size, int a, int c,
+                    int y, int x) {
+    if (fmt == RKNN_TENSOR_NHWC) {
+        return ((size_t) (y * grid_w + x) * anchors + a) * prop_size + c;
+    }
+    return ((size_t) (a * prop_size + c) * grid_h + y) * grid_w + x;
+}
+
+int attr_grid_h(const rknn_tensor_attr &attr) {
+    return attr.fmt == RKNN_TENSOR_NHWC ? attr.dims[1] : attr.dims[2];
+}
+
+int attr_grid_w(const rknn_tensor_attr &attr) {
+    return attr.fmt == RKNN_TENSOR_NHWC ? attr.dims[2] : attr.dims[3];
+}
+
+size_t value_index(const StubOutput &out, int prop_size, int a, int c, int y, int x) {
+    return layout_index(out.attr.fmt, attr_grid_h(out.attr), attr_grid_w(out.attr), out.anchors, prop_size, a, c,
+                        y, x);
+}
+
+// the same head in the other layout, like the runtime's native NHWC output attr
+rknn_tensor_attr nhwc_attr(const rknn_tensor_attr &attr) {
+    rknn_tensor_attr nhwc = attr;
+    nhwc.fmt = RKNN_TENSOR_NHWC;
+    nhwc.dims[1] = attr_grid_h(attr);
+    nhwc.dims[2] = attr_grid_w(attr);
+    nhwc.dims[3] = attr.fmt == RKNN_TENSOR_NHWC ? attr.dims[3] : attr.dims[1];
+    return nhwc;
+}
+
+// copy elements of elem_size bytes from the output layout to fmt
+void transpose_output(const StubOutput &out, const uint8_t *src, int elem_size, rknn_tensor_format fmt,
+                      uint8_t *dst) {
+    int grid_h = attr_grid_h(out.attr);
+    int grid_w = attr_grid_w(out.attr);
+    int prop_size = (int) (out.attr.n_elems / (out.anchors * grid_h * grid_w));
+    for (int a = 0; a < out.anchors; a++) {
+        for (int c = 0; c < prop_size; c++) {
+            for (int y = 0; y < grid_h; y++) {
+                for (int x = 0; x < grid_w; x++) {
+                    memcpy(dst + layout_index(fmt, grid_h, grid_w, out.anchors, prop_size, a, c, y, x) * elem_size,
+                           src + value_index(out, prop_size, a, c, y, x) * elem_size, elem_size);
+                }
+            }
+        }
+    }
+}
+
+// output count of a branch: the YOLOv5 head, or the DFL box, score and score sum outputs
+int outputs_per_branch(const rknn_stub_config_t &cfg) {
+    return cfg.heads == RKNN_STUB_HEADS_DFL ? (cfg.score_sum ? 3 : 2) : 1;
+}
+
+struct StubObject {
+    float cx, cy, w, h;
+    int cls;
+    int branch;
+};
+
+StubObject random_object(const rknn_stub_config_t &cfg, uint32_t *rnd) {
+    StubObject obj;
+    obj.w = random_range(rnd, 12.f, cfg.width * 0.6f);
+    obj.h = random_range(rnd, 12.f, cfg.height * 0.6f);
+    obj.cx = random_range(rnd, 0.f, (float) cfg.width);
+    obj.cy = random_range(rnd, 0.f, (float) cfg.height);
+    obj.cls = (int) (next_random(rnd) % cfg.num_classes);
+    float side = obj.w > obj.h ? obj.w : obj.h;
+    obj.branch = side < 64.f ? 0 : (side < 192.f ? 1 : 2);
+    return obj;
+}
+
+void plant_object(StubContext *sc, uint32_t *rnd) {
+    const rknn_stub_config_t &cfg = sc->config;
+    int prop_size = 5 + cfg.num_classes;
+    StubObject obj = random_object(cfg, rnd);
+    float w = obj.w;
+    float h = obj.h;
+    float cx = obj.cx;
+    float cy = obj.cy;
+    int cls = obj.cls;
+    int branch = obj.branch;
+    int best_a = 0;
+    float best_err = 1e9f;
+    for (int a = 0; a < kAnchorPerBranch; a++) {
+        float err = fabsf(logf(w / kAnchors[branch][a * 2])) +
+                    fabsf(logf(h / kAnchors[branch][a * 2 + 1]));
+        if (err < best_err) {
+            best_err = err;
+            best_a = a;
+        }
+    }
+
+    StubOutput &out = sc->outputs[branch];
+    int grid_h = cfg.height / kStrides[branch];
+    int grid_w = cfg.width / kStrides[branch];
+    float stride = (float) kStrides[branch];
+    int ci = (int) (cy / stride);
+    int cj = (int) (cx / stride);
+    for (int di = -1; di <= 1; di++) {
+        for (int dj = -1; dj <= 1; dj++) {
+            int i = ci + di;
+            int j = cj + dj;
+            if (i < 0 || i >= grid_h || j < 0 || j >= grid_w) {
+                continue;
+            }
+            float conf = 0.92f - 0.12f * (abs(di) + abs(dj)) + random_range(rnd, -0.04f, 0.04f);
+            float aw = (float) kAnchors[branch][best_a * 2];
+            float ah = (float) kAnchors[branch][best_a * 2 + 1];
+            float jitter_w = w * random_range(rnd, 0.92f, 1.08f);
+            float jitter_h = h * random_range(rnd, 0.92f, 1.08f);
+            float v[5];
+            v[0] = clamp01((cx / stride - j + 0.5f) / 2.f);
+            v[1] = clamp01((cy / stride - i + 0.5f) / 2.f);
+            v[2] = clamp01(sqrtf(jitter_w / aw) / 2.f);
+            v[3] = clamp01(sqrtf(jitter_h / ah) / 2.f);
+            v[4] = clamp01(conf);
+            for (int c = 0; c < 5; c++) {
+                out.values[value_index(out, prop_size, best_a, c, i, j)] = v[c];
+            }
+            out.values[value_index(out, prop_size, best_a, 5 + cls, i, j)] =
+                    clamp01(random_range(rnd, 0.8f, 0.97f));
+        }
+    }
+}
+
+// a peaked distribution over the box bins whose softmax expectation is about d
+void encode_distance(StubOutput &box, int side, float d, int i, int j) {
+    d = d < 0.f ? 0.f : (d > kDflLen - 1 ? (float) (kDflLen - 1) : d);
+    for (int k = 0; k < kDflLen; k++) {
+        float logit = -2.f * (k - d) * (k - d);
+        box.values[value_index(box, 4 * kDflLen, 0, side * kDflLen + k, i, j)] = logit < -12.f ? -12.f : logit;
+    }
+}
+
+void plant_object_dfl(StubContext *sc, uint32_t *rnd) {
+    const rknn_stub_config_t &cfg = sc->config;
+    StubObject obj = random_object(cfg, rnd);
+    int per_branch = outputs_per_branch(cfg);
+    StubOutput &box = sc->outputs[obj.branch * per_branch];
+    StubOutput &score = sc->outputs[obj.branch * per_branch + 1];
+    int grid_h = cfg.height / kStrides[obj.branch];
+    int grid_w = cfg.width / kStrides[obj.branch];
+    float stride = (float) kStrides[obj.branch];
+    int ci = (int) (obj.cy / stride);
+    int cj = (int) (obj.cx / stride);
+    for (int di = -1; di <= 1; di++) {
+        for (int dj = -1; dj <= 1; dj++) {
+            int i = ci + di;
+            int j = cj + dj;
+            if (i < 0 || i >= grid_h || j < 0 || j >= grid_w) {
+                continue;
+            }
+            float w = obj.w * random_range(rnd, 0.92f, 1.08f);
+            float h = obj.h * random_range(rnd, 0.92f, 1.08f);
+            // distances of the box sides from the cell center, in cells
+            float x = (j + 0.5f) * stride;
+            float y = (i + 0.5f) * stride;
+            encode_distance(box, 0, (x - (obj.cx - w / 2)) / stride, i, j);
+            encode_distance(box, 1, (y - (obj.cy - h / 2)) / stride, i, j);
+            encode_distance(box, 2, (obj.cx + w / 2 - x) / stride, i, j);
+            encode_distance(box, 3, (obj.cy + h / 2 - y) / stride, i, j);
+            float conf = 0.92f - 0.12f * (abs(di) + abs(dj)) + random_range(rnd, -0.04f, 0.04f);
+            score.values[value_index(score, cfg.num_classes, 0, obj.cls, i, j)] = clamp01(conf);
+        }
+    }
+}
+
+// the score sum output of each branch, the class scores of a cell added up and clipped to 1
+void sum_scores(StubContext *sc) {
+    const rknn_stub_config_t &cfg = sc->config;
+    for (int b = 0; b < kBranchNum; b++) {
+        const StubOutput &score = sc->outputs[b * 3 + 1];
+        StubOutput &sum = sc->outputs[b * 3 + 2];
+        int grid_h = cfg.height / kStrides[b];
+        int grid_w = cfg.width / kStrides[b];
+        for (int i = 0; i < grid_h; i++) {
+            for (int j = 0; j < grid_w; j++) {
+                float total = 0.f;
+                for (int c = 0; c < cfg.num_classes; c++) {
+                    total += score.values[value_index(score, cfg.num_classes, 0, c, i, j)];
+                }
+                sum.values[value_index(sum, 1, 0, 0, i, j)] = clamp01(total);
+            }
+        }
+    }
+}
+
+void encode_output(StubOutput &out) {
+    size_t n = out.values.size();
+    out.native.resize(n * type_bytes(out.attr.type));
+    if (out.attr.type == RKNN_TENSOR_FLOAT32) {
+        memcpy(out.native.data(), out.values.data(), n * sizeof(float));
+    } else if (out.attr.type == RKNN_TENSOR_FLOAT16) {
+        uint16_t *dst = (uint16_t *) out.native.data();
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = rknpu2::float16::bits(out.values[i]);
+        }
+    } else {
+        int8_t *dst = (int8_t *) out.native.data();
+        for (size_t i = 0; i < n; i++) {
+            float q = roundf(out.values[i] / out.attr.scale) + out.attr.zp;
+            dst[i] = (int8_t) (q < -128.f ? -128.f : (q > 127.f ? 127.f : q));
+        }
+    }
+}
+
+// YOLOv8 branches: flat box distributions and faint class scores in the background
+void generate_scene_dfl(StubContext *sc, uint32_t *rnd) {
+    int per_branch = outputs_per_branch(sc->config);
+    for (size_t o = 0; o < sc->outputs.size(); o++) {
+        StubOutput &out = sc->outputs[o];
+        int kind = (int) (o % per_branch);
+        for (size_t i = 0; i < out.values.size(); i++) {
+            out.values[i] = kind == 0 ? random_range(rnd, -4.f, 0.f) : random_range(rnd, 0.f, 0.004f);
+        }
+    }
+    for (int k = 0; k < sc->config.num_objects; k++) {
+        plant_object_dfl(sc, rnd);
+    }
+    if (sc->config.score_sum) {
+        sum_scores(sc);
+    }
+    for (size_t o = 0; o < sc->outputs.size(); o++) {
+        encode_output(sc->outputs[o]);
+    }
+}
+
+void generate_scene(StubContext *sc) {
+    uint32_t rnd = sc->config.seed ? sc->config.seed : 0x9e3779b9u;
+    if (sc->config.heads == RKNN_STUB_HEADS_DFL) {
+        generate_scene_dfl(sc, &rnd);
+        return;
+    }
+    int prop_size = 5 + sc->config.num_classes;
+    for (size_t b = 0; b < sc->outputs.size(); b++) {
+        StubOutput &out = sc->outputs[b];
+        for (size_t i = 0; i < out.values.size(); i++) {
+            out.values[i] = random_range(&rnd, 0.f, 0.06f);
+        }
+        int grid_h = sc->config.height / kStrides[b];
+        int grid_w = sc->config.width / kStrides[b];
+        for (int a = 0; a < kAnchorPerBranch; a++) {
+            for (int i = 0; i < grid_h; i++) {
+                for (int j = 0; j < grid_w; j++) {
+                    for (int c = 0; c < 4; c++) {
+                        out.values[value_index(out, prop_size, a, c, i, j)] =
+                                random_range(&rnd, 0.35f, 0.65f);
+                    }
+                }
+            }
+        }
+    }
+    for (int k = 0; k < sc->config.num_objects; k++) {
+        plant_object(sc, &rnd);
+    }
+    for (size_t b = 0; b < sc->outputs.size(); b++) {
+        encode_output(sc->outputs[b]);
+    }
+}
+
+void to_float(const StubOutput &out, float *dst) {
+    size_t n = out.attr.n_elems;
+    if (out.attr.type == RKNN_TENSOR_FLOAT32) {
+        memcpy(dst, out.native.data(), n * sizeof(float));
+    } else if (out.attr.type == RKNN_TENSOR_FLOAT16) {
+        const uint16_t *src = (const uint16_t *) out.native.data();
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = (float) rknpu2::float16::fromBits(src[i]);
+        }
+    } else {
+        const int8_t *src = (const int8_t *) out.native.data();
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = ((float) src[i] - (float) out.attr.zp) * out.attr.scale;
+        }
+    }
+}
+
+StubContext *get_context(rknn_context ctx) {
+    return reinterpret_cast<StubContext *>(ctx);
+}
+
+}  // namespace
+
+void rknn_stub_default_config(rknn_stub_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->width = 640;
+    config->height = 640;
+    config->channel = 3;
+    config->num_classes = 80;
+    config->num_objects = 8;
+    config->output_type = RKNN_TENSOR_INT8;
+    config->output_fmt = RKNN_TENSOR_NCHW;
+    config->seed = 0x5eed;
+    config->heads = RKNN_STUB_HEADS_ANCHOR;
+    config->score_sum = 1;
+}
+
+void rknn_stub_set_config(const rknn_stub_config_t *config) {
+    g_config = *config;
+    g_config_set = true;
+}
+
+int rknn_stub_set_outputs(rknn_context ctx, uint32_t n_outputs, void *const *bufs) {
+    StubContext *sc = get_context(ctx);
+    if (sc == NULL) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (n_outputs != sc->outputs.size() || bufs == NULL) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    for (uint32_t i = 0; i < n_outputs; i++) {
+        memcpy(sc->outputs[i].native.data(), bufs[i], sc->outputs[i].native.size());
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_init(rknn_context *context, void *model, uint32_t size, uint32_t flag,
+              rknn_init_extend *extend) {
+    if (context == NULL) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    StubContext *sc = new StubContext();
+    if (g_config_set) {
+        sc->config = g_config;
+    } else {
+        rknn_stub_default_config(&sc->config);
+    }
+    if (model != NULL && size >= 8 && memcmp(model, "RKNNSTUB", 8) == 0) {
+        parse_stub_model((const char *) model, size, &sc->config);
+    }
+    rknn_stub_config_t &cfg = sc->config;
+    if (cfg.width <= 0 || cfg.height <= 0 || cfg.width % 32 != 0 || cfg.height % 32 != 0 ||
+        cfg.num_classes <= 0) {
+        delete sc;
+        return RKNN_ERR_MODEL_INVALID;
+    }
+    if (cfg.input_w_stride < cfg.width) {
+        cfg.input_w_stride = cfg.width;
+    }
+
+    rknn_tensor_attr &in = sc->input_attr;
+    memset(&in, 0, sizeof(in));
+    snprintf(in.name, sizeof(in.name), "images");
+    in.n_dims = 4;
+    in.dims[0] = 1;
+    in.dims[1] = cfg.height;
+    in.dims[2] = cfg.width;
+    in.dims[3] = cfg.channel;
+    in.n_elems = cfg.height * cfg.width * cfg.channel;
+    in.size = in.n_elems;
+    in.fmt = RKNN_TENSOR_NHWC;
+    in.type = RKNN_TENSOR_INT8;
+    in.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+    in.zp = kQuantZp;
+    in.scale = kQuantScale;
+    in.w_stride = cfg.input_w_stride;
+    in.size_with_stride = cfg.height * cfg.input_w_stride * cfg.channel;
+    sc->input.resize(in.size_with_stride);
+
+    int dfl = cfg.heads == RKNN_STUB_HEADS_DFL;
+    int per_branch = outputs_per_branch(cfg);
+    sc->outputs.resize(kBranchNum * per_branch);
+    for (int o = 0; o < kBranchNum * per_branch; o++) {
+        int b = o / per_branch;
+        int kind = o % per_branch;
+        StubOutput &out = sc->outputs[o];
+        rknn_tensor_attr &attr = out.attr;
+        memset(&attr, 0, sizeof(attr));
+        int grid_h = cfg.height / kStrides[b];
+        int grid_w = cfg.width / kStrides[b];
+        // YOLOv5: 3 anchors of (x, y, w, h, obj, classes...); YOLOv8: box bins, class scores, score sum
+        out.anchors = dfl ? 1 : kAnchorPerBranch;
+        int channels = !dfl ? kAnchorPerBranch * (5 + cfg.num_classes) :
+                       kind == 0 ? 4 * kDflLen : (kind == 1 ? cfg.num_classes : 1);
+        attr.index = o;
+        if (dfl) {
+            snprintf(attr.name, sizeof(attr.name), "%s%d", kind == 0 ? "box" : (kind == 1 ? "score" : "score_sum"), b);
+        } else {
+            snprintf(attr.name, sizeof(attr.name), "output%d", b);
+        }
+        attr.n_dims = 4;
+        attr.dims[0] = 1;
+        if (cfg.output_fmt == RKNN_TENSOR_NHWC) {
+            attr.dims[1] = grid_h;
+            attr.dims[2] = grid_w;
+            attr.dims[3] = channels;
+        } else {
+            attr.dims[1] = channels;
+            attr.dims[2] = grid_h;
+            attr.dims[3] = grid_w;
+        }
+        attr.n_elems = channels * grid_h * grid_w;
+        attr.fmt = cfg.output_fmt;
+        attr.type = cfg.output_type;
+        attr.size = attr.n_elems * type_bytes(attr.type);
+        attr.w_stride = grid_w;
+        attr.size_with_stride = attr.size;
+        if (attr.type == RKNN_TENSOR_INT8) {
+            attr.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+            attr.zp = dfl && kind == 0 ? kDflQuantZp : kQuantZp;
+            attr.scale = dfl && kind == 0 ? kDflQuantScale : kQuantScale;
+        } else {
+            attr.qnt_type = RKNN_TENSOR_QNT_NONE;
+            attr.scale = 1.f;
+        }
+        out.values.resize(attr.n_elems);
+        out.as_float.resize(attr.n_elems);
+        out.io_mem = NULL;
+        out.io_type = attr.type;
+        out.io_fmt = attr.fmt;
+    }
+    sc->input_mem = NULL;
+    generate_scene(sc);
+    // the scene is built in branch order, the runtime indexes then follow the listed order
+    if (cfg.reverse_outputs) {
+        std::reverse(sc->outputs.begin(), sc->outputs.end());
+        for (size_t o = 0; o < sc->outputs.size(); o++) {
+            sc->outputs[o].attr.index = (uint32_t) o;
+        }
+    }
+
+    *context = reinterpret_cast<rknn_context>(sc);
+    return RKNN_SUCC;
+}
+
+int rknn_destroy(rknn_context context) {
+    delete get_context(context);
+    return RKNN_SUCC;
+}
+
+int rknn_query(rknn_context context, rknn_query_cmd cmd, void *info, uint32_t size) {
+    StubContext *sc = get_context(context);
+    if (sc == NULL) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (info == NULL) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    switch (cmd) {
+        case RKNN_QUERY_IN_OUT_NUM: {
+            if (size < sizeof(rknn_input_output_num)) {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+            rknn_input_output_num *io_num = (rknn_input_output_num *) info;
+            io_num->n_input = 1;
+            io_num->n_output = (uint32_t) sc->outputs.size();
+            return RKNN_SUCC;
+        }
+        case RKNN_QUERY_INPUT_ATTR: {
+            rknn_tensor_attr *attr = (rknn_tensor_attr *) info;
+            if (size < sizeof(rknn_tensor_attr) || attr->index != 0) {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+            *attr = sc->input_attr;
+            return RKNN_SUCC;
+        }
+        case RKNN_QUERY_OUTPUT_ATTR: {
+            rknn_tensor_attr *attr = (rknn_tensor_attr *) info;
+            if (size < sizeof(rknn_tensor_attr) || attr->index >= sc->outputs.size()) {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+            *attr = sc->outputs[attr->index].attr;
+            return RKNN_SUCC;
+        }
+        case RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR: {
+            rknn_tensor_attr *attr = (rknn_tensor_attr *) info;
+            if (size < sizeof(rknn_tensor_attr) || attr->index >= sc->outputs.size()) {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+            *attr = nhwc_attr(sc->outputs[attr->index].attr);
+            return RKNN_SUCC;
+        }
+        case RKNN_QUERY_CUSTOM_STRING: {
+            if (size < sizeof(rknn_custom_string)) {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+            rknn_custom_string *custom = (rknn_custom_string *) info;
+            snprintf(custom->string, sizeof(custom->string), "%s", sc->config.custom_string);
+            return RKNN_SUCC;
+        }
+        case RKNN_QUERY_SDK_VERSION: {
+            if (size < sizeof(rknn_sdk_version)) {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+            rknn_sdk_version *version = (rknn_sdk_version *) info;
+            snprintf(version->api_version, sizeof(version->api_version), "host-stub");
+            snprintf(version->drv_version, sizeof(version->drv_version), "host-stub");
+            return RKNN_SUCC;
+        }
+        default:
+            return RKNN_ERR_PARAM_INVALID;
+    }
+}
+
+int rknn_inputs_set(rknn_context context, uint32_t n_inputs, rknn_input inputs[]) {
+    StubContext *sc = get_context(context);
+    if (sc == NULL) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (n_inputs != 1 || inputs == NULL || inputs[0].buf == NULL ||
+        inputs[0].size < sc->input_attr.n_elems) {
+        return RKNN_ERR_INPUT_INVALID;
+    }
+    // the runtime copies the input into NPU memory, keep that cost visible
+    int row = sc->input_attr.dims[2] * sc->input_attr.dims[3];
+    int dst_row = sc->input_attr.w_stride * sc->input_attr.dims[3];
+    const uint8_t *src = (const uint8_t *) inputs[0].buf;
+    for (uint32_t h = 0; h < sc->input_attr.dims[1]; h++) {
+        memcpy(sc->input.data() + (size_t) h * dst_row, src + (size_t) h * row, row);
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_run(rknn_context context, rknn_run_extend *extend) {
+    StubContext *sc = get_context(context);
+    if (sc == NULL) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    for (size_t i = 0; i < sc->outputs.size(); i++) {
+        StubOutput &out = sc->outputs[i];
+        if (out.io_mem == NULL) {
+            continue;
+        }
+        if (out.io_type != out.attr.type && out.io_type != RKNN_TENSOR_FLOAT32) {
+            return RKNN_ERR_OUTPUT_INVALID;
+        }
+        if (out.io_fmt == out.attr.fmt) {
+            if (out.io_type == out.attr.type) {
+                memcpy(out.io_mem->virt_addr, out.native.data(), out.native.size());
+            } else {
+                to_float(out, (float *) out.io_mem->virt_addr);
+            }
+            continue;
+        }
+        // the other layout was asked for by rknn_set_io_mem
+        const uint8_t *src = out.native.data();
+        if (out.io_type != out.attr.type) {
+            to_float(out, out.as_float.data());
+            src = (const uint8_t *) out.as_float.data();
+        }
+        transpose_output(out, src, type_bytes(out.io_type), out.io_fmt, (uint8_t *) out.io_mem->virt_addr);
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_get(rknn_context context, uint32_t n_outputs, rknn_output outputs[],
+                     rknn_output_extend *extend) {
+    StubContext *sc = get_context(context);
+    if (sc == NULL) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (outputs == NULL || n_outputs > sc->outputs.size()) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    for (uint32_t i = 0; i < n_outputs; i++) {
+        if (outputs[i].index >= sc->outputs.size()) {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        StubOutput &out = sc->outputs[outputs[i].index];
+        void *data;
+        uint32_t data_size;
+        if (outputs[i].want_float && out.attr.type != RKNN_TENSOR_FLOAT32) {
+            to_float(out, out.as_float.data());
+            data = out.as_float.data();
+            data_size = out.attr.n_elems * sizeof(float);
+        } else {
+            data = out.native.data();
+            data_size = (uint32_t) out.native.size();
+        }
+        if (outputs[i].is_prealloc) {
+            if (outputs[i].buf == NULL || outputs[i].size < data_size) {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+            memcpy(outputs[i].buf, data, data_size);
+        } else {
+            outputs[i].buf = data;
+            outputs[i].size = data_size;
+        }
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_release(rknn_context context, uint32_t n_ouputs, rknn_output outputs[]) {
+    // output buffers are owned by the context and reused across frames
+    return get_context(context) == NULL ? RKNN_ERR_CTX_INVALID : RKNN_SUCC;
+}
+
+rknn_tensor_mem *rknn_create_mem(rknn_context ctx, uint32_t size) {
+    rknn_tensor_mem *mem = (rknn_tensor_mem *) calloc(1, sizeof(rknn_tensor_mem));
+    if (mem == NULL) {
+        return NULL;
+    }
+    mem->virt_addr = calloc(1, size);
+    if (mem->virt_addr == NULL) {
+        free(mem);
+        return NULL;
+    }
+    mem->fd = -1;
+    mem->size = size;
+    mem->flags = RKNN_TENSOR_MEMORY_FLAGS_ALLOC_INSIDE;
+    return mem;
+}
+
+int rknn_destroy_mem(rknn_context ctx, rknn_tensor_mem *mem) {
+    if (mem == NULL) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    free(mem->virt_addr);
+    free(mem);
+    return RKNN_SUCC;
+}
+
+int rknn_set_io_mem(rknn_context ctx, rknn_tensor_mem *mem, rknn_tensor_attr *attr) {
+    StubContext *sc = get_context(ctx);
+    if (sc == NULL) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (mem == NULL || attr == NULL) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    if (strcmp(attr->name, sc->input_attr.name) == 0) {
+        if (mem->size < sc->input_attr.size_with_stride) {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        sc->input_mem = mem;
+        return RKNN_SUCC;
+    }
+    if (attr->index >= sc->outputs.size()) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    StubOutput &out = sc->outputs[attr->index];
+    if (mem->size < out.attr.n_elems * (uint32_t) type_bytes(attr->type)) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    if (attr->fmt != RKNN_TENSOR_NCHW && attr->fmt != RKNN_TENSOR_NHWC) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    out.io_mem = mem;
+    out.io_type = attr->type;
+    out.io_fmt = attr->fmt;
+    return RKNN_SUCC;
+}
@@ -0,0 +1,74 @@
+#ifndef _RKNN_HOST_STUB_H_
+#define _RKNN_HOST_STUB_H_
+
+#include "rknn_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Head family of the synthetic model
+ */
+typedef enum {
+    RKNN_STUB_HEADS_ANCHOR = 0,     /* YOLOv5: 3 heads of 3 anchors x (5 + num_classes) channels */
+    RKNN_STUB_HEADS_DFL,            /* YOLOv8: per branch 4 x 16 box bins, num_classes scores, score sum */
+} rknn_stub_heads_t;
+
+/**
+ * @brief Shape of the synthetic model served by the host runtime stub
+ *
+ * The stub exposes one NHWC uint8 input and three detection branches (stride 8/16/32):
+ * by default one YOLOv5 head of 3 anchors x (5 + num_classes) channels each, with
+ * RKNN_STUB_HEADS_DFL the 2 or 3 outputs of an anchor-free YOLOv8 branch.
+ */
+typedef struct {
+    int width;                      /* model input width */
+    int height;                     /* model input height */
+    int channel;                    /* model input channel */
+    int input_w_stride;             /* input row stride in pixels, 0 means width */
+    int num_classes;                /* class count of every detection head */
+    int num_objects;                /* synthetic objects planted per frame */
+    rknn_tensor_type output_type;   /* RKNN_TENSOR_INT8, RKNN_TENSOR_FLOAT16 or RKNN_TENSOR_FLOAT32 */
+    rknn_tensor_format output_fmt;  /* RKNN_TENSOR_NCHW or RKNN_TENSOR_NHWC */
+    uint32_t seed;                  /* seed of the synthetic scene */
+    rknn_stub_heads_t heads;        /* head family, RKNN_STUB_HEADS_ANCHOR by default */
+    int score_sum;                  /* DFL heads: export the clipped class score sum of each branch */
+    int reverse_outputs;            /* list the outputs last first, as some exports order them */
+    char custom_string[256];        /* returned by RKNN_QUERY_CUSTOM_STRING */
+} rknn_stub_config_t;
+
+/**
+ * @brief Fill config with the defaults (640x640 int8 NCHW, 80 classes, 8 objects)
+ *
+ * @param config [out] Stub config
+ */
+void rknn_stub_default_config(rknn_stub_config_t* config);
+
+/**
+ * @brief Set the config used by subsequent rknn_init() calls
+ *
+ * A model blob starting with "RKNNSTUB" overrides it with whitespace separated
+ * key=value pairs (width, height, classes, objects, type=int8|fp16|fp32,
+ * fmt=nchw|nhwc, w_stride, seed, heads=yolov5|yolov8, score_sum=0|1, reverse_outputs=0|1,
+ * custom=<text up to the next whitespace>), so a text file can stand in for a .rknn model.
+ *
+ * @param config [in] Stub config
+ */
+void rknn_stub_set_config(const rknn_stub_config_t* config);
+
+/**
+ * @brief Replace the tensors produced by subsequent rknn_run() calls
+ *
+ * @param ctx [in] Context returned by rknn_init()
+ * @param n_outputs [in] Number of buffers, must match the model output number
+ * @param bufs [in] Output data in the native type and layout of each output attr
+ * @return int RKNN_SUCC or a RKNN_ERR_* code
+ */
+int rknn_stub_set_outputs(rknn_context ctx, uint32_t n_outputs, void* const* bufs);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif //_RKNN_HOST_STUB_H_
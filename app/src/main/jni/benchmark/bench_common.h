@@ -0,0 +1,149 @@
+#ifndef _RKNN_YOLOV5_BENCH_COMMON_H_
+#define _RKNN_YOLOV5_BENCH_COMMON_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "rknn_stub.h"
+#include "utils/common.h"
+#include "utils/image_utils_internal.h"
+
+// Raw head outputs of the stub runtime's synthetic scene, in the int8 layout handed to
+// post_process() for quantized models, the float32 one for fp models, and the fp16 one
+// of a model exported with fp16 outputs (f16_attrs).
+struct SyntheticHeads {
+    int num_classes;
+    rknn_tensor_attr attrs[3];
+    rknn_tensor_attr f16_attrs[3];
+    std::vector<int8_t> i8[3];
+    std::vector<float> f32[3];
+    std::vector<uint16_t> f16[3];
+};
+
+static inline bool read_synthetic_f16_heads(SyntheticHeads *heads) {
+    rknn_context ctx = 0;
+    if (rknn_init(&ctx, NULL, 0, 0, NULL) != RKNN_SUCC) {
+        return false;
+    }
+    rknn_output outputs[3];
+    memset(outputs, 0, sizeof(outputs));
+    for (int i = 0; i < 3; i++) {
+        heads->f16_attrs[i].index = i;
+        rknn_query(ctx, RKNN_QUERY_OUTPUT_ATTR, &heads->f16_attrs[i], sizeof(rknn_tensor_attr));
+        outputs[i].index = i;
+    }
+    rknn_run(ctx, NULL);
+    rknn_outputs_get(ctx, 3, outputs, NULL);
+    for (int i = 0; i < 3; i++) {
+        size_t n = heads->f16_attrs[i].n_elems;
+        heads->f16[i].assign((uint16_t *) outputs[i].buf, (uint16_t *) outputs[i].buf + n);
+    }
+    rknn_outputs_release(ctx, 3, outputs);
+    rknn_destroy(ctx);
+    return true;
+}
+
+static inline bool make_synthetic_heads(int num_classes, int num_objects, rknn_tensor_format fmt,
+                                        SyntheticHeads *heads) {
+    rknn_stub_config_t config;
+    rknn_stub_default_config(&config);
+    config.num_classes = num_classes;
+    config.num_objects = num_objects;
+    config.output_fmt = fmt;
+    rknn_stub_set_config(&config);
+
+    rknn_context ctx = 0;
+    if (rknn_init(&ctx, NULL, 0, 0, NULL) != RKNN_SUCC) {
+        return false;
+    }
+    heads->num_classes = num_classes;
+    rknn_output outputs[3];
+    memset(outputs, 0, sizeof(outputs));
+    for (int want_float = 0; want_float <= 1; want_float++) {
+        for (int i = 0; i < 3; i++) {
+            heads->attrs[i].index = i;
+            rknn_query(ctx, RKNN_QUERY_OUTPUT_ATTR, &heads->attrs[i], sizeof(rknn_tensor_attr));
+            outputs[i].index = i;
+            outputs[i].want_float = want_float;
+        }
+        rknn_run(ctx, NULL);
+        rknn_outputs_get(ctx, 3, outputs, NULL);
+        for (int i = 0; i < 3; i++) {
+            size_t n = heads->attrs[i].n_elems;
+            if (want_float) {
+                heads->f32[i].assign((float *) outputs[i].buf, (float *) outputs[i].buf + n);
+            } else {
+                heads->i8[i].assign((int8_t *) outputs[i].buf, (int8_t *) outputs[i].buf + n);
+            }
+        }
+        rknn_outputs_release(ctx, 3, outputs);
+    }
+    rknn_destroy(ctx);
+
+    config.output_type = RKNN_TENSOR_FLOAT16;
+    rknn_stub_set_config(&config);
+    return read_synthetic_f16_heads(heads);
+}
+
+// Outputs of the stub runtime's synthetic YOLOv8 scene: 3 branches of box bins, class
+// scores and, with score_sum, their sum; in the native type of each output
+struct SyntheticDflHeads {
+    std::vector<rknn_tensor_attr> attrs;
+    std::vector<std::vector<uint8_t> > data;
+    rknn_input_output_num io_num;
+};
+
+static inline bool make_synthetic_dfl_heads(int num_classes, int num_objects, rknn_tensor_type type,
+                                            int score_sum, SyntheticDflHeads *heads) {
+    rknn_stub_config_t config;
+    rknn_stub_default_config(&config);
+    config.num_classes = num_classes;
+    config.num_objects = num_objects;
+    config.output_type = type;
+    config.heads = RKNN_STUB_HEADS_DFL;
+    config.score_sum = score_sum;
+    rknn_stub_set_config(&config);
+
+    rknn_context ctx = 0;
+    if (rknn_init(&ctx, NULL, 0, 0, NULL) != RKNN_SUCC) {
+        return false;
+    }
+    rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &heads->io_num, sizeof(heads->io_num));
+    uint32_t n = heads->io_num.n_output;
+    heads->attrs.resize(n);
+    heads->data.resize(n);
+    std::vector<rknn_output> outputs(n);
+    for (uint32_t i = 0; i < n; i++) {
+        memset(&heads->attrs[i], 0, sizeof(rknn_tensor_attr));
+        heads->attrs[i].index = i;
+        rknn_query(ctx, RKNN_QUERY_OUTPUT_ATTR, &heads->attrs[i], sizeof(rknn_tensor_attr));
+        memset(&outputs[i], 0, sizeof(rknn_output));
+        outputs[i].index = i;
+    }
+    rknn_run(ctx, NULL);
+    rknn_outputs_get(ctx, n, outputs.data(), NULL);
+    for (uint32_t i = 0; i < n; i++) {
+        heads->data[i].assign((uint8_t *) outputs[i].buf, (uint8_t *) outputs[i].buf + outputs[i].size);
+    }
+    rknn_outputs_release(ctx, n, outputs.data());
+    rknn_destroy(ctx);
+    return true;
+}
+
+// Box the source lands in, computed by convert_image_with_letterbox() itself
+static inline void letterbox_box(int src_w, int src_h, int dst_w, int dst_h, image_rect_t *box) {
+    letterbox_t letterbox;
+    compute_letterbox(src_w, src_h, dst_w, dst_h, box, &letterbox);
+}
+
+static inline void fill_random(unsigned char *data, size_t size, uint32_t seed) {
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        data[i] = (unsigned char) (seed >> 24);
+    }
+}
+
+#endif //_RKNN_YOLOV5_BENCH_COMMON_H_
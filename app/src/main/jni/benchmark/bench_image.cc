@@ -0,0 +1,310 @@
+// Pre-process and drawing stages: CPU letterbox resize, box/label drawing and jpeg io.
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.h"
+#include "utils/image_drawing.h"
+#include "utils/image_utils.h"
+#include "utils/image_utils_internal.h"
+#include "utils/thread_pool.h"
+
+namespace {
+
+const int kModelSize = 640;
+
+void SourceSizes(benchmark::internal::Benchmark *b, const std::vector<int64_t> &channels) {
+    const int sizes[][2] = {{640, 480}, {1280, 720}, {1920, 1080}};
+    for (size_t c = 0; c < channels.size(); c++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            b->Args({channels[c], sizes[s][0], sizes[s][1]});
+        }
+    }
+    b->ArgNames({"ch", "src_w", "src_h"});
+}
+
+void set_pixel_rate(benchmark::State &state, int64_t pixels) {
+    state.counters["MPix"] = benchmark::Counter((double) pixels * state.iterations() / 1e6,
+                                                benchmark::Counter::kIsRate);
+}
+
+void BM_crop_and_scale_image_c(benchmark::State &state) {
+    int channel = state.range(0);
+    int src_w = state.range(1);
+    int src_h = state.range(2);
+    std::vector<unsigned char> src((size_t) src_w * src_h * channel);
+    std::vector<unsigned char> dst((size_t) kModelSize * kModelSize * channel);
+    fill_random(src.data(), src.size(), 1);
+    image_rect_t box;
+    letterbox_box(src_w, src_h, kModelSize, kModelSize, &box);
+    int box_w = box.right - box.left + 1;
+    int box_h = box.bottom - box.top + 1;
+
+    for (auto _ : state) {
+        crop_and_scale_image_c(channel, src.data(), src_w, src_h, 0, 0, src_w, src_h,
+                               dst.data(), kModelSize, kModelSize, box.left, box.top, box_w, box_h);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    set_pixel_rate(state, (int64_t) box_w * box_h);
+}
+BENCHMARK(BM_crop_and_scale_image_c)->Apply([](benchmark::internal::Benchmark *b) {
+    SourceSizes(b, {1, 3, 4});
+});
+
+void BM_crop_and_scale_image_yuv420sp(benchmark::State &state) {
+    int src_w = state.range(1);
+    int src_h = state.range(2);
+    std::vector<unsigned char> src((size_t) src_w * src_h * 3 / 2);
+    std::vector<unsigned char> dst((size_t) kModelSize * kModelSize * 3 / 2);
+    fill_random(src.data(), src.size(), 2);
+    image_rect_t box;
+    letterbox_box(src_w, src_h, kModelSize, kModelSize, &box);
+    int box_w = box.right - box.left + 1;
+    int box_h = box.bottom - box.top + 1;
+
+    for (auto _ : state) {
+        crop_and_scale_image_yuv420sp(src.data(), src_w, src_h, 0, 0, src_w, src_h,
+                                      dst.data(), kModelSize, kModelSize,
+                                      box.left, box.top, box_w, box_h);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    set_pixel_rate(state, (int64_t) box_w * box_h);
+}
+BENCHMARK(BM_crop_and_scale_image_yuv420sp)->Apply([](benchmark::internal::Benchmark *b) {
+    SourceSizes(b, {0});
+});
+
+void BM_crop_and_scale_image_rgba_to_rgb(benchmark::State &state) {
+    int src_w = state.range(1);
+    int src_h = state.range(2);
+    std::vector<unsigned char> src((size_t) src_w * src_h * 4);
+    std::vector<unsigned char> dst((size_t) kModelSize * kModelSize * 3);
+    fill_random(src.data(), src.size(), 5);
+    image_rect_t box;
+    letterbox_box(src_w, src_h, kModelSize, kModelSize, &box);
+    int box_w = box.right - box.left + 1;
+    int box_h = box.bottom - box.top + 1;
+
+    for (auto _ : state) {
+        crop_and_scale_image_rgba_to_rgb(src.data(), src_w, src_h, 0, 0, src_w, src_h,
+                                         dst.data(), kModelSize, kModelSize,
+                                         box.left, box.top, box_w, box_h);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    set_pixel_rate(state, (int64_t) box_w * box_h);
+}
+BENCHMARK(BM_crop_and_scale_image_rgba_to_rgb)->Apply([](benchmark::internal::Benchmark *b) {
+    SourceSizes(b, {4});
+});
+
+void BM_crop_and_scale_image_yuv420sp_to_rgb(benchmark::State &state) {
+    int src_w = state.range(1);
+    int src_h = state.range(2);
+    std::vector<unsigned char> src((size_t) src_w * src_h * 3 / 2);
+    std::vector<unsigned char> dst((size_t) kModelSize * kModelSize * 3);
+    fill_random(src.data(), src.size(), 6);
+    image_rect_t box;
+    letterbox_box(src_w, src_h, kModelSize, kModelSize, &box);
+    int box_w = box.right - box.left + 1;
+    int box_h = box.bottom - box.top + 1;
+
+    for (auto _ : state) {
+        crop_and_scale_image_yuv420sp_to_rgb(1, src.data(), src_w, src_h, src_w, 0, 0, src_w, src_h,
+                                             dst.data(), kModelSize, kModelSize,
+                                             box.left, box.top, box_w, box_h);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    set_pixel_rate(state, (int64_t) box_w * box_h);
+}
+BENCHMARK(BM_crop_and_scale_image_yuv420sp_to_rgb)->Apply([](benchmark::internal::Benchmark *b) {
+    SourceSizes(b, {0});
+});
+
+void BM_convert_image_with_letterbox(benchmark::State &state) {
+    int src_w = state.range(1);
+    int src_h = state.range(2);
+    image_buffer_t src;
+    memset(&src, 0, sizeof(src));
+    src.width = src_w;
+    src.height = src_h;
+    src.format = state.range(0) == 4 ? IMAGE_FORMAT_RGBA8888 : IMAGE_FORMAT_RGB888;
+    src.size = get_image_size(&src);
+    std::vector<unsigned char> src_data(src.size);
+    fill_random(src_data.data(), src_data.size(), 3);
+    src.virt_addr = src_data.data();
+
+    image_buffer_t dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.width = kModelSize;
+    dst.height = kModelSize;
+    dst.format = IMAGE_FORMAT_RGB888;
+    dst.size = get_image_size(&dst);
+    std::vector<unsigned char> dst_data(dst.size);
+    dst.virt_addr = dst_data.data();
+
+    letterbox_t letter_box;
+    for (auto _ : state) {
+        if (convert_image_with_letterbox(&src, &dst, &letter_box, 114) != 0) {
+            state.SkipWithError("convert_image_with_letterbox failed");
+            break;
+        }
+        benchmark::DoNotOptimize(dst.virt_addr);
+    }
+    set_pixel_rate(state, (int64_t) kModelSize * kModelSize);
+}
+BENCHMARK(BM_convert_image_with_letterbox)->Apply([](benchmark::internal::Benchmark *b) {
+    SourceSizes(b, {3, 4});
+});
+
+// Same letterbox split into row bands on a thread pool, as the app context runs it
+void BM_convert_image_with_letterbox_bands(benchmark::State &state) {
+    int threads = state.range(0);
+    int src_w = 1920;
+    int src_h = 1080;
+    image_buffer_t src;
+    memset(&src, 0, sizeof(src));
+    src.width = src_w;
+    src.height = src_h;
+    src.format = IMAGE_FORMAT_RGBA8888;
+    src.size = get_image_size(&src);
+    std::vector<unsigned char> src_data(src.size);
+    fill_random(src_data.data(), src_data.size(), 3);
+    src.virt_addr = src_data.data();
+
+    image_buffer_t dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.width = kModelSize;
+    dst.height = kModelSize;
+    dst.format = IMAGE_FORMAT_RGB888;
+    dst.size = get_image_size(&dst);
+    std::vector<unsigned char> dst_data(dst.size);
+    dst.virt_addr = dst_data.data();
+
+    image_preprocess_t pp;
+    memset(&pp, 0, sizeof(pp));
+    pp.pool = thread_pool_create(threads);
+    pp.bands = state.range(1);
+
+    letterbox_t letter_box;
+    for (auto _ : state) {
+        if (convert_image_with_letterbox_ctx(&pp, &src, &dst, &letter_box, 114) != 0) {
+            state.SkipWithError("convert_image_with_letterbox_ctx failed");
+            break;
+        }
+        benchmark::DoNotOptimize(dst.virt_addr);
+    }
+    release_preprocess_cache(&pp);
+    thread_pool_destroy(pp.pool);
+    set_pixel_rate(state, (int64_t) kModelSize * kModelSize);
+}
+BENCHMARK(BM_convert_image_with_letterbox_bands)
+        ->ArgsProduct({{1, 2, 4}, {1, 4, 8}})->ArgNames({"threads", "bands"})->UseRealTime();
+
+void make_rgb_image(int width, int height, std::vector<unsigned char> *data, image_buffer_t *image) {
+    memset(image, 0, sizeof(*image));
+    image->width = width;
+    image->height = height;
+    image->format = IMAGE_FORMAT_RGB888;
+    image->size = get_image_size(image);
+    data->resize(image->size);
+    fill_random(data->data(), data->size(), 4);
+    image->virt_addr = data->data();
+}
+
+// state.range(0): image width (16:9), state.range(1): boxes per frame
+void BM_draw_rectangle(benchmark::State &state) {
+    int width = state.range(0);
+    int height = width * 9 / 16;
+    int boxes = state.range(1);
+    std::vector<unsigned char> data;
+    image_buffer_t image;
+    make_rgb_image(width, height, &data, &image);
+
+    for (auto _ : state) {
+        for (int i = 0; i < boxes; i++) {
+            int x = (i * 97) % (width - 100);
+            int y = (i * 61) % (height - 100);
+            draw_rectangle(&image, x, y, 80, 120, COLOR_BLUE, 3);
+        }
+        benchmark::DoNotOptimize(image.virt_addr);
+    }
+    state.counters["boxes"] = benchmark::Counter((double) boxes * state.iterations(),
+                                                 benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_draw_rectangle)->ArgsProduct({{640, 1920}, {1, 16, 128}})->ArgNames({"w", "boxes"});
+
+void BM_draw_text(benchmark::State &state) {
+    int width = state.range(0);
+    int height = width * 9 / 16;
+    int boxes = state.range(1);
+    std::vector<unsigned char> data;
+    image_buffer_t image;
+    make_rgb_image(width, height, &data, &image);
+
+    for (auto _ : state) {
+        for (int i = 0; i < boxes; i++) {
+            int x = (i * 97) % (width - 100);
+            int y = (i * 61) % (height - 100) + 20;
+            draw_text(&image, "person 87.5%", x, y - 20, COLOR_RED, 10);
+        }
+        benchmark::DoNotOptimize(image.virt_addr);
+    }
+    state.counters["boxes"] = benchmark::Counter((double) boxes * state.iterations(),
+                                                 benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_draw_text)->ArgsProduct({{640, 1920}, {1, 16, 128}})->ArgNames({"w", "boxes"});
+
+std::string temp_jpeg_path() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/rknn_yolov5_bench_%d.jpg", (int) getpid());
+    return path;
+}
+
+void BM_write_image_jpeg(benchmark::State &state) {
+    std::vector<unsigned char> data;
+    image_buffer_t image;
+    make_rgb_image(state.range(0), state.range(0) * 9 / 16, &data, &image);
+    std::string path = temp_jpeg_path();
+    // write_image() reports success even when the encoder produced nothing
+    if (write_image(path.c_str(), &image) != 0 || access(path.c_str(), R_OK) != 0) {
+        state.SkipWithError("jpeg encoder unavailable");
+        return;
+    }
+
+    for (auto _ : state) {
+        write_image(path.c_str(), &image);
+    }
+    unlink(path.c_str());
+    set_pixel_rate(state, (int64_t) image.width * image.height);
+}
+BENCHMARK(BM_write_image_jpeg)->Arg(640)->Arg(1920)->ArgName("w");
+
+void BM_read_image_jpeg(benchmark::State &state) {
+    std::vector<unsigned char> data;
+    image_buffer_t image;
+    make_rgb_image(state.range(0), state.range(0) * 9 / 16, &data, &image);
+    std::string path = temp_jpeg_path();
+    if (write_image(path.c_str(), &image) != 0 || access(path.c_str(), R_OK) != 0) {
+        state.SkipWithError("jpeg encoder unavailable");
+        return;
+    }
+
+    std::vector<unsigned char> decoded(image.size);
+    for (auto _ : state) {
+        image_buffer_t out;
+        memset(&out, 0, sizeof(out));
+        out.virt_addr = decoded.data();
+        if (read_image(path.c_str(), &out) != 0) {
+            state.SkipWithError("jpeg decoder unavailable");
+            break;
+        }
+        benchmark::DoNotOptimize(out.virt_addr);
+    }
+    unlink(path.c_str());
+    set_pixel_rate(state, (int64_t) image.width * image.height);
+}
+BENCHMARK(BM_read_image_jpeg)->Arg(640)->Arg(1920)->ArgName("w");
+
+}  // namespace
@@ -0,0 +1,437 @@
+// Post-process stages: head decode, score sort, NMS and the whole post_process().
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.h"
+#include "postprocess.h"
+#include "postprocess_internal.h"
+#include "utils/thread_pool.h"
+
+namespace {
+
+const int kModelSize = 640;
+const int kStrides[3] = {8, 16, 32};
+int kAnchors[3][6] = {{10, 13, 16, 30, 33, 23},
+                      {30, 61, 62, 45, 59, 119},
+                      {116, 90, 156, 198, 373, 326}};
+
+void set_rates(benchmark::State &state, int64_t cells, int64_t boxes) {
+    state.counters["cells"] = benchmark::Counter((double) cells * state.iterations(),
+                                                 benchmark::Counter::kIsRate);
+    state.counters["boxes"] = benchmark::Counter((double) boxes * state.iterations(),
+                                                 benchmark::Counter::kIsRate);
+}
+
+// Model context over the synthetic heads, decode state built as init_yolov5_model does
+struct SyntheticModel {
+    SyntheticHeads heads;
+    rknn_app_context_t app_ctx;
+};
+
+// type is the head type post_process() reads: INT8 (quantized), FLOAT16 or FLOAT32
+bool make_synthetic_model(int num_classes, int num_objects, rknn_tensor_format fmt, rknn_tensor_type type,
+                          SyntheticModel *m) {
+    make_synthetic_heads(num_classes, num_objects, fmt, &m->heads);
+    memset(&m->app_ctx, 0, sizeof(m->app_ctx));
+    m->app_ctx.io_num.n_output = 3;
+    m->app_ctx.output_attrs = type == RKNN_TENSOR_FLOAT16 ? m->heads.f16_attrs : m->heads.attrs;
+    m->app_ctx.model_width = kModelSize;
+    m->app_ctx.model_height = kModelSize;
+    m->app_ctx.is_quant = type == RKNN_TENSOR_INT8;
+    return init_yolov5_decode(&m->app_ctx) == 0;
+}
+
+int64_t total_cells() {
+    int64_t cells = 0;
+    for (int i = 0; i < 3; i++) {
+        cells += 3 * (kModelSize / kStrides[i]) * (kModelSize / kStrides[i]);
+    }
+    return cells;
+}
+
+// Decode of the 3 heads by one kernel, decode_head(m, decode, i, grid) runs it on head i and
+// returns the boxes it kept. state.range(0): synthetic objects per frame, state.range(1):
+// classes of the model
+template<typename DecodeHead>
+void run_head_kernel(benchmark::State &state, rknn_tensor_format fmt, rknn_tensor_type type,
+                     DecodeHead decode_head) {
+    SyntheticModel m;
+    make_synthetic_model(state.range(1), state.range(0), fmt, type, &m);
+    yolov5_decode *decode = m.app_ctx.decode;
+    int64_t valid = 0;
+    for (auto _ : state) {
+        decode->cand.count = 0;
+        valid = 0;
+        for (int i = 0; i < 3; i++) {
+            valid += decode_head(m, decode, i, kModelSize / kStrides[i]);
+        }
+        benchmark::DoNotOptimize(decode->cand.x1);
+    }
+    release_yolov5_decode(&m.app_ctx);
+    set_rates(state, total_cells(), valid);
+}
+
+void head_kernel_args(benchmark::internal::Benchmark *b) {
+    b->ArgsProduct({{0, 8, 64, 256}, {1, 80}})->ArgNames({"objects", "classes"});
+}
+
+void BM_process_i8(benchmark::State &state) {
+    run_head_kernel(state, RKNN_TENSOR_NCHW, RKNN_TENSOR_INT8,
+                    [](SyntheticModel &m, yolov5_decode *d, int i, int grid) {
+        return process_i8(m.heads.i8[i].data(), &d->lut[i], grid, grid, d->num_classes, &d->cand, BOX_THRESH);
+    });
+}
+BENCHMARK(BM_process_i8)->Apply(head_kernel_args);
+
+void BM_process_i8_rv1106(benchmark::State &state) {
+    run_head_kernel(state, RKNN_TENSOR_NHWC, RKNN_TENSOR_INT8,
+                    [](SyntheticModel &m, yolov5_decode *d, int i, int grid) {
+        return process_i8_rv1106(m.heads.i8[i].data(), &d->lut[i], grid, grid, d->num_classes, &d->cand,
+                                 BOX_THRESH);
+    });
+}
+BENCHMARK(BM_process_i8_rv1106)->Apply(head_kernel_args);
+
+void BM_process_fp32(benchmark::State &state) {
+    run_head_kernel(state, RKNN_TENSOR_NCHW, RKNN_TENSOR_FLOAT32,
+                    [](SyntheticModel &m, yolov5_decode *d, int i, int grid) {
+        return process_fp32(m.heads.f32[i].data(), kAnchors[i], grid, grid, d->num_classes, kStrides[i],
+                            &d->cand, BOX_THRESH);
+    });
+}
+BENCHMARK(BM_process_fp32)->Apply(head_kernel_args);
+
+void BM_process_fp32_nhwc(benchmark::State &state) {
+    run_head_kernel(state, RKNN_TENSOR_NHWC, RKNN_TENSOR_FLOAT32,
+                    [](SyntheticModel &m, yolov5_decode *d, int i, int grid) {
+        return process_fp32_nhwc(m.heads.f32[i].data(), kAnchors[i], grid, grid, d->num_classes, kStrides[i],
+                                 &d->cand, BOX_THRESH);
+    });
+}
+BENCHMARK(BM_process_fp32_nhwc)->Apply(head_kernel_args);
+
+void BM_process_f16(benchmark::State &state) {
+    run_head_kernel(state, RKNN_TENSOR_NCHW, RKNN_TENSOR_FLOAT16,
+                    [](SyntheticModel &m, yolov5_decode *d, int i, int grid) {
+        return process_f16(m.heads.f16[i].data(), kAnchors[i], grid, grid, d->num_classes, kStrides[i],
+                           &d->cand, BOX_THRESH);
+    });
+}
+BENCHMARK(BM_process_f16)->Apply(head_kernel_args);
+
+void BM_process_f16_nhwc(benchmark::State &state) {
+    run_head_kernel(state, RKNN_TENSOR_NHWC, RKNN_TENSOR_FLOAT16,
+                    [](SyntheticModel &m, yolov5_decode *d, int i, int grid) {
+        return process_f16_nhwc(m.heads.f16[i].data(), kAnchors[i], grid, grid, d->num_classes, kStrides[i],
+                                &d->cand, BOX_THRESH);
+    });
+}
+BENCHMARK(BM_process_f16_nhwc)->Apply(head_kernel_args);
+
+// state.range(0): 0 topk_indices, 1 radix_topk_indices, state.range(1): candidate count,
+// state.range(2): distinct score levels (0: continuous); the best PRE_NMS_TOPK are kept
+void BM_topk_indices(benchmark::State &state) {
+    int n = state.range(1);
+    int levels = state.range(2);
+    std::vector<float> scores(n);
+    uint32_t seed = 7;
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        float r = (float) (seed >> 8) / (float) (1 << 24);
+        scores[i] = levels > 0 ? (float) (int) (r * levels) / levels : r;
+    }
+    std::vector<uint32_t> keys(n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = score_key(scores[i]);
+    }
+    std::vector<int> order(n);
+    std::vector<uint32_t> scratch(3 * n);
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            topk_indices(scores.data(), n, PRE_NMS_TOPK, order.data());
+        } else {
+            radix_topk_indices(keys.data(), n, PRE_NMS_TOPK, order.data(), scratch.data());
+        }
+        benchmark::DoNotOptimize(order.data());
+    }
+    state.counters["boxes"] = benchmark::Counter((double) n * state.iterations(),
+                                                 benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_topk_indices)
+        ->ArgsProduct({{0, 1}, {64, 512, 2048, 8192}, {0, 16}})->ArgNames({"radix", "n", "levels"});
+
+// Candidates of a synthetic scene, sorted and laid out as post_process() hands them to nms()
+struct Candidates {
+    int count;
+    std::vector<float> soa;
+    std::vector<int> cls;
+    nms_boxes_t boxes;
+};
+
+void make_candidates(int num_classes, int num_objects, Candidates *c) {
+    SyntheticModel m;
+    make_synthetic_model(num_classes, num_objects, RKNN_TENSOR_NCHW, RKNN_TENSOR_INT8, &m);
+    candidate_arena_t *cand = &m.app_ctx.decode->cand;
+    for (int i = 0; i < 3; i++) {
+        int grid = kModelSize / kStrides[i];
+        process_i8(m.heads.i8[i].data(), &m.app_ctx.decode->lut[i], grid, grid, num_classes, cand,
+                   BOX_THRESH);
+    }
+    int n = cand->count;
+    topk_indices(cand->score, n, 0, cand->order);
+    c->count = n;
+    c->soa.resize(5 * n + 1);
+    c->cls.resize(n + 1);
+    c->boxes.count = n;
+    c->boxes.x1 = c->soa.data();
+    c->boxes.y1 = c->boxes.x1 + n;
+    c->boxes.x2 = c->boxes.y1 + n;
+    c->boxes.y2 = c->boxes.x2 + n;
+    c->boxes.area = c->boxes.y2 + n;
+    c->boxes.cls = c->cls.data();
+    c->boxes.order = NULL;
+    for (int i = 0; i < n; i++) {
+        int k = cand->order[i];
+        c->boxes.x1[i] = cand->x1[k];
+        c->boxes.y1[i] = cand->y1[k];
+        c->boxes.x2[i] = cand->x2[k];
+        c->boxes.y2[i] = cand->y2[k];
+        c->boxes.area[i] = cand->area[k];
+        c->boxes.cls[i] = cand->cls[k];
+    }
+    release_yolov5_decode(&m.app_ctx);
+}
+
+void BM_nms(benchmark::State &state) {
+    Candidates c;
+    make_candidates(state.range(1), state.range(0), &c);
+    int keep[OBJ_NUMB_MAX_SIZE];
+    int kept = 0;
+    for (auto _ : state) {
+        kept = nms(&c.boxes, NMS_THRESH, OBJ_NUMB_MAX_SIZE, keep);
+        benchmark::DoNotOptimize(keep);
+    }
+    state.counters["candidates"] = c.count;
+    state.counters["kept"] = kept;
+    state.counters["boxes"] = benchmark::Counter((double) c.count * state.iterations(),
+                                                 benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_nms)->ArgsProduct({{8, 64, 256}, {1, 80}})->ArgNames({"objects", "classes"});
+
+// A crowd of small objects, each seen as a few jittered boxes, in descending score order
+void make_crowd_candidates(int count, Candidates *c) {
+    uint32_t seed = 11;
+    auto rnd = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (float) (seed >> 8) / (float) (1 << 24);
+    };
+    int n = count;
+    c->count = n;
+    c->soa.assign(5 * n + 1, 0.f);
+    c->cls.assign(n + 1, 0);
+    c->boxes.count = n;
+    c->boxes.x1 = c->soa.data();
+    c->boxes.y1 = c->boxes.x1 + n;
+    c->boxes.x2 = c->boxes.y1 + n;
+    c->boxes.y2 = c->boxes.x2 + n;
+    c->boxes.area = c->boxes.y2 + n;
+    c->boxes.cls = c->cls.data();
+    c->boxes.order = NULL;
+    float cx = 0.f, cy = 0.f, w = 0.f, h = 0.f;
+    for (int i = 0; i < n; i++) {
+        if (i % 4 == 0) {
+            w = 12.f + rnd() * 36.f;
+            h = w * (1.5f + rnd());
+            cx = rnd() * kModelSize;
+            cy = rnd() * kModelSize;
+        }
+        float jx = (rnd() - 0.5f) * 0.2f * w;
+        float jy = (rnd() - 0.5f) * 0.2f * h;
+        c->boxes.x1[i] = cx + jx - w / 2;
+        c->boxes.y1[i] = cy + jy - h / 2;
+        c->boxes.x2[i] = cx + jx + w / 2;
+        c->boxes.y2[i] = cy + jy + h / 2;
+        c->boxes.area[i] = (w + 1.f) * (h + 1.f);
+    }
+    // scores fall with the index, shuffle objects against each other
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int) (rnd() * (i + 1)) % (i + 1);
+        std::swap(c->boxes.x1[i], c->boxes.x1[j]);
+        std::swap(c->boxes.y1[i], c->boxes.y1[j]);
+        std::swap(c->boxes.x2[i], c->boxes.x2[j]);
+        std::swap(c->boxes.y2[i], c->boxes.y2[j]);
+        std::swap(c->boxes.area[i], c->boxes.area[j]);
+    }
+}
+
+// state.range(0): nms_engine_t, state.range(1): candidates of a crowd scene. Past
+// OBJ_NUMB_MAX_SIZE kept boxes both engines stop early, the crossover, if any, is below.
+void BM_nms_engines(benchmark::State &state) {
+    Candidates c;
+    make_crowd_candidates(state.range(1), &c);
+    int keep[OBJ_NUMB_MAX_SIZE];
+    int kept = 0;
+    for (auto _ : state) {
+        kept = state.range(0) == NMS_ENGINE_GRID
+               ? nms_grid(&c.boxes, NMS_THRESH, OBJ_NUMB_MAX_SIZE, kModelSize, kModelSize, keep)
+               : nms(&c.boxes, NMS_THRESH, OBJ_NUMB_MAX_SIZE, keep);
+        benchmark::DoNotOptimize(keep);
+    }
+    state.counters["kept"] = kept;
+    state.counters["boxes"] = benchmark::Counter((double) c.count * state.iterations(),
+                                                 benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_nms_engines)
+        ->ArgsProduct({{NMS_ENGINE_EXHAUSTIVE, NMS_ENGINE_GRID}, {64, 128, 256, 512, 1024, 2048, 4096}})
+        ->ArgNames({"engine", "candidates"});
+
+void BM_post_process(benchmark::State &state) {
+    SyntheticModel m;
+    make_synthetic_model(state.range(1), state.range(0), state.range(2) ? RKNN_TENSOR_NHWC : RKNN_TENSOR_NCHW,
+                         RKNN_TENSOR_INT8, &m);
+    void *outputs[3] = {m.heads.i8[0].data(), m.heads.i8[1].data(), m.heads.i8[2].data()};
+    letterbox_t letter_box = {0, 80, 0.5f};
+    object_detect_result_list od_results;
+
+    for (auto _ : state) {
+        post_process(&m.app_ctx, outputs, &letter_box, NULL, &od_results);
+        benchmark::DoNotOptimize(od_results.count);
+    }
+    release_yolov5_decode(&m.app_ctx);
+    state.counters["detections"] = od_results.count;
+    set_rates(state, total_cells(), od_results.count);
+}
+BENCHMARK(BM_post_process)
+        ->ArgsProduct({{0, 8, 64, 256}, {1, 80}, {0, 1}})->ArgNames({"objects", "classes", "nhwc"});
+
+// Float model, fp16 heads read in place against the float32 copy want_float used to make
+void BM_post_process_float(benchmark::State &state) {
+    SyntheticModel m;
+    rknn_tensor_type type = state.range(2) ? RKNN_TENSOR_FLOAT16 : RKNN_TENSOR_FLOAT32;
+    make_synthetic_model(state.range(1), state.range(0), RKNN_TENSOR_NCHW, type, &m);
+    void *outputs[3];
+    for (int i = 0; i < 3; i++) {
+        outputs[i] = type == RKNN_TENSOR_FLOAT16 ? (void *) m.heads.f16[i].data() : (void *) m.heads.f32[i].data();
+    }
+    letterbox_t letter_box = {0, 80, 0.5f};
+    object_detect_result_list od_results;
+
+    for (auto _ : state) {
+        post_process(&m.app_ctx, outputs, &letter_box, NULL, &od_results);
+        benchmark::DoNotOptimize(od_results.count);
+    }
+    release_yolov5_decode(&m.app_ctx);
+    state.counters["detections"] = od_results.count;
+    set_rates(state, total_cells(), od_results.count);
+}
+BENCHMARK(BM_post_process_float)
+        ->ArgsProduct({{0, 8, 64, 256}, {1, 80}, {0, 1}})->ArgNames({"objects", "classes", "fp16"});
+
+// Per-call options on a crowded COCO scene: a lower result cap ends NMS early and an
+// allowlist (the first state.range(1) of person, car, motorcycle, bus, truck) limits the
+// decode to those class channels
+void BM_post_process_options(benchmark::State &state) {
+    SyntheticModel m;
+    make_synthetic_model(80, 256, RKNN_TENSOR_NCHW, RKNN_TENSOR_INT8, &m);
+    void *outputs[3] = {m.heads.i8[0].data(), m.heads.i8[1].data(), m.heads.i8[2].data()};
+    letterbox_t letter_box = {0, 80, 0.5f};
+    object_detect_result_list od_results;
+    const int classes[5] = {0, 2, 3, 5, 7};
+    detect_options_t opts;
+    default_detect_options(&opts);
+    opts.max_detections = state.range(0);
+    opts.class_allowlist = classes;
+    opts.num_allowed_classes = state.range(1);
+
+    for (auto _ : state) {
+        post_process(&m.app_ctx, outputs, &letter_box, &opts, &od_results);
+        benchmark::DoNotOptimize(od_results.count);
+    }
+    release_yolov5_decode(&m.app_ctx);
+    state.counters["detections"] = od_results.count;
+    set_rates(state, total_cells(), od_results.count);
+}
+BENCHMARK(BM_post_process_options)
+        ->ArgsProduct({{1, 16, OBJ_NUMB_MAX_SIZE}, {0, 1, 5}})->ArgNames({"max_detections", "allowlist"});
+
+// Anchor-free YOLOv8 branches through the same top-K, NMS and result path, state.range(2):
+// int8, fp16 or fp32 outputs, state.range(3): the score sum output exported
+void BM_post_process_dfl(benchmark::State &state) {
+    const rknn_tensor_type types[3] = {RKNN_TENSOR_INT8, RKNN_TENSOR_FLOAT16, RKNN_TENSOR_FLOAT32};
+    rknn_tensor_type type = types[state.range(2)];
+    SyntheticDflHeads heads;
+    make_synthetic_dfl_heads(state.range(1), state.range(0), type, state.range(3), &heads);
+    rknn_app_context_t app_ctx;
+    memset(&app_ctx, 0, sizeof(app_ctx));
+    app_ctx.io_num = heads.io_num;
+    app_ctx.output_attrs = heads.attrs.data();
+    app_ctx.model_width = kModelSize;
+    app_ctx.model_height = kModelSize;
+    app_ctx.is_quant = type == RKNN_TENSOR_INT8;
+    if (init_yolov5_decode(&app_ctx) != 0) {
+        state.SkipWithError("init_yolov5_decode failed");
+        return;
+    }
+    std::vector<void *> outputs(heads.data.size());
+    for (size_t i = 0; i < heads.data.size(); i++) {
+        outputs[i] = heads.data[i].data();
+    }
+    letterbox_t letter_box = {0, 80, 0.5f};
+    object_detect_result_list od_results;
+
+    for (auto _ : state) {
+        post_process(&app_ctx, outputs.data(), &letter_box, NULL, &od_results);
+        benchmark::DoNotOptimize(od_results.count);
+    }
+    release_yolov5_decode(&app_ctx);
+    state.counters["detections"] = od_results.count;
+    set_rates(state, total_cells() / 3, od_results.count);
+}
+BENCHMARK(BM_post_process_dfl)
+        ->ArgsProduct({{0, 8, 64, 256}, {1, 80}, {0, 1, 2}, {0, 1}})
+        ->ArgNames({"objects", "classes", "type", "score_sum"});
+
+// Box side expectation over 16 bins, state.range(0): 1 for the vectorized one
+void BM_dfl_expect(benchmark::State &state) {
+    const int kSides = 1024;
+    std::vector<float> bins(kSides * 16);
+    uint32_t seed = 7;
+    for (size_t i = 0; i < bins.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        bins[i] = (float) (seed >> 8) / (float) (1 << 24) * 16.f - 12.f;
+    }
+    float (*expect)(const float *, int) = state.range(0) ? dfl_expect : dfl_expect_scalar;
+    for (auto _ : state) {
+        float total = 0.f;
+        for (int k = 0; k < kSides; k++) {
+            total += expect(&bins[k * 16], 16);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * kSides);
+}
+BENCHMARK(BM_dfl_expect)->Arg(0)->Arg(1)->ArgName("simd");
+
+// Same with the head decode fanned out over a thread pool, as the app context runs it
+void BM_post_process_pool(benchmark::State &state) {
+    SyntheticModel m;
+    make_synthetic_model(state.range(2), state.range(1), RKNN_TENSOR_NCHW, RKNN_TENSOR_INT8, &m);
+    m.app_ctx.pool = thread_pool_create(state.range(0));
+    void *outputs[3] = {m.heads.i8[0].data(), m.heads.i8[1].data(), m.heads.i8[2].data()};
+    letterbox_t letter_box = {0, 80, 0.5f};
+    object_detect_result_list od_results;
+
+    for (auto _ : state) {
+        post_process(&m.app_ctx, outputs, &letter_box, NULL, &od_results);
+        benchmark::DoNotOptimize(od_results.count);
+    }
+    thread_pool_destroy(m.app_ctx.pool);
+    release_yolov5_decode(&m.app_ctx);
+    state.counters["detections"] = od_results.count;
+    set_rates(state, total_cells(), od_results.count);
+}
+BENCHMARK(BM_post_process_pool)
+        ->ArgsProduct({{1, 2, 4}, {0, 256}, {1, 80}})->ArgNames({"threads", "objects", "classes"})
+        ->UseRealTime();
+
+}  // namespace
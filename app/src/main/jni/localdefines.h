@@ -1,7 +1,9 @@
 #ifndef LOCALDEFINES_H_
 #define LOCALDEFINES_H_
 
+#ifdef __ANDROID__
 #include <jni.h>
+#endif
 
 #ifndef LOG_TAG
 #define LOG_TAG "libUVCCamera"
@@ -46,6 +48,8 @@
 #define		JTYPE_SYSTEM				"Ljava/lang/System;"
 #define		JTYPE_UVCCAMERA				"Lcom/serenegiant/usb/UVCCamera;"
 //
+#ifdef __ANDROID__
 typedef		jlong						ID_TYPE;
+#endif
 
 #endif /* LOCALDEFINES_H_ */
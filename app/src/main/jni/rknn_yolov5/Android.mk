@@ -18,13 +18,21 @@ LOCAL_SHARED_LIBRARIES += rknnrt-shared
 LOCAL_STATIC_LIBRARIES += rga-static
 LOCAL_STATIC_LIBRARIES += turbojpeg-static
 
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON := true
+endif
+
 LOCAL_MODULE    := rknn_yolov5
 LOCAL_SRC_FILES :=  \
 	utils/file_utils.c \
 	utils/image_drawing.c \
+	utils/image_resize.c \
 	utils/image_utils.c \
+	utils/thread_pool.c \
 	main.cc \
+	decode_config.cc \
 	postprocess.cc \
+	tensor_record.cc \
 	rknn_yolov5_jni.cc \
 	yolov5.cc \
 	yolov5_zerocopy.cc \
@@ -0,0 +1,193 @@
+#include "decode_config.h"
+#include "utils/file_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+// the stock YOLOv5 models: COCO anchors, strides and classes from the outputs
+static const decode_config_t default_config = {
+        {{10,  13, 16,  30,  33,  23},
+         {30,  61, 62,  45,  59,  119},
+         {116, 90, 156, 198, 373, 326}},
+        {0, 0, 0},
+        0,
+        114,
+        0,
+        {0},
+};
+
+void default_decode_config(decode_config_t *config) {
+    *config = default_config;
+}
+
+// numbers of a value separated by ',' or '/', the count read; -1 when one is malformed or
+// there are more than max_count
+static int parse_numbers(const std::string &value, float *numbers, int max_count) {
+    int count = 0;
+    const char *p = value.c_str();
+    while (*p != '\0') {
+        char *end;
+        float v = strtof(p, &end);
+        if (end == p || count == max_count || (*end != '\0' && *end != ',' && *end != '/')) {
+            return -1;
+        }
+        numbers[count++] = v;
+        p = *end != '\0' ? end + 1 : end;
+    }
+    return count;
+}
+
+// one key=value entry, unknown keys are skipped so newer configs load
+static int parse_entry(const std::string &key, const std::string &value, decode_config_t *config) {
+    float v[DECODE_CONFIG_MAX_OUTPUTS > 18 ? DECODE_CONFIG_MAX_OUTPUTS : 18];
+    int n = parse_numbers(value, v, (int) (sizeof(v) / sizeof(v[0])));
+    if (n < 0) {
+        return -1;
+    }
+    if (key == "anchors") {
+        if (n != 18) {
+            return -1;
+        }
+        for (int k = 0; k < 18; k++) {
+            if (v[k] <= 0.f) {
+                return -1;
+            }
+            config->anchors[k / 6][k % 6] = (int) v[k];
+        }
+    } else if (key == "strides") {
+        if (n != 3) {
+            return -1;
+        }
+        for (int k = 0; k < 3; k++) {
+            if (v[k] < 1.f) {
+                return -1;
+            }
+            config->strides[k] = (int) v[k];
+        }
+    } else if (key == "classes") {
+        if (n != 1 || v[0] < 1.f) {
+            return -1;
+        }
+        config->num_classes = (int) v[0];
+    } else if (key == "pad") {
+        if (n != 1 || v[0] < 0.f || v[0] > 255.f) {
+            return -1;
+        }
+        config->pad_color = (int) v[0];
+    } else if (key == "outputs") {
+        if (n > DECODE_CONFIG_MAX_OUTPUTS) {
+            return -1;
+        }
+        for (int k = 0; k < n; k++) {
+            if (v[k] < 0.f) {
+                return -1;
+            }
+            config->output_order[k] = (int) v[k];
+        }
+        config->num_outputs = n;
+    } else {
+        LOGI("decode config: skip unknown key %s\n", key.c_str());
+    }
+    return 0;
+}
+
+int parse_decode_config(const char *text, decode_config_t *config) {
+    const char *p = text;
+    while (*p != '\0') {
+        if (*p == '#') {
+            while (*p != '\0' && *p != '\n') {
+                p++;
+            }
+            continue;
+        }
+        size_t len = strcspn(p, " \t\r\n;#");
+        if (len == 0) {
+            p++;
+            continue;
+        }
+        std::string token(p, len);
+        p += len;
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        if (parse_entry(token.substr(0, eq), token.substr(eq + 1), config) != 0) {
+            LOGE("decode config: bad value %s\n", token.c_str());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int load_decode_config(rknn_context ctx, const char *model_path, decode_config_t *config) {
+    default_decode_config(config);
+
+    // embedded at conversion, rknn.config(custom_string=...)
+    rknn_custom_string custom;
+    memset(&custom, 0, sizeof(custom));
+    if (rknn_query(ctx, RKNN_QUERY_CUSTOM_STRING, &custom, sizeof(custom)) == RKNN_SUCC &&
+        custom.string[0] != '\0') {
+        custom.string[sizeof(custom.string) - 1] = '\0';
+        LOGI("decode config: custom string %s\n", custom.string);
+        if (parse_decode_config(custom.string, config) != 0) {
+            return -1;
+        }
+    }
+
+    // shipped next to the model, overrides the custom string
+    std::string path(model_path);
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        path.erase(dot);
+    }
+    path += DECODE_CONFIG_SUFFIX;
+    if (access(path.c_str(), R_OK) == 0) {
+        char *text = NULL;
+        if (read_data_from_file(path.c_str(), &text) < 0) {
+            LOGE("decode config: read %s fail!\n", path.c_str());
+            return -1;
+        }
+        LOGI("decode config: %s\n", path.c_str());
+        int ret = parse_decode_config(text, config);
+        free(text);
+        if (ret != 0) {
+            return -1;
+        }
+    }
+    LOGI("decode config: pad %d\n", config->pad_color);
+    return 0;
+}
+
+int reorder_output_attrs(const decode_config_t *config, rknn_tensor_attr *output_attrs, int n_output) {
+    if (config->num_outputs == 0) {
+        return 0;
+    }
+    if (config->num_outputs != n_output || n_output > DECODE_CONFIG_MAX_OUTPUTS) {
+        LOGE("decode config: %d outputs in the order, the model has %d\n", config->num_outputs, n_output);
+        return -1;
+    }
+    rknn_tensor_attr runtime[DECODE_CONFIG_MAX_OUTPUTS];
+    int seen[DECODE_CONFIG_MAX_OUTPUTS];
+    memcpy(runtime, output_attrs, n_output * sizeof(rknn_tensor_attr));
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < n_output; i++) {
+        int k = config->output_order[i];
+        if (k >= n_output || seen[k]) {
+            LOGE("decode config: output order is not a permutation of 0..%d\n", n_output - 1);
+            return -1;
+        }
+        seen[k] = 1;
+        output_attrs[i] = runtime[k];
+        LOGI("decode config: slot %d reads output %d (%s)\n", i, runtime[k].index, runtime[k].name);
+    }
+    return 0;
+}
+
+const decode_config_t *yolov5_decode_config(const rknn_app_context_t *app_ctx) {
+    return app_ctx->decode_config != NULL ? app_ctx->decode_config : &default_config;
+}
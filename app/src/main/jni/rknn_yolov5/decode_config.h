@@ -0,0 +1,81 @@
+#ifndef _RKNN_YOLOV5_DEMO_DECODE_CONFIG_H_
+#define _RKNN_YOLOV5_DEMO_DECODE_CONFIG_H_
+
+#include "rknn_api.h"
+#include "utils/common.h"
+
+/*
+ * Decode config text, from the custom string of the model and from a sidecar file next to
+ * it (the model path with a .cfg extension, its keys override). key=value entries separated
+ * by spaces, ';' or new lines, '#' comments to the end of the line, unknown keys are skipped:
+ *
+ *   anchors=10,13,16,30,33,23/30,61,62,45,59,119/116,90,156,198,373,326   w,h of 3 anchors per head
+ *   strides=8,16,32            model pixels per cell of each head, one value for both axes
+ *   classes=80                 checked against the output channels
+ *   pad=114                    letterbox fill
+ *   outputs=0,1,2              runtime output of each decoder slot
+ */
+#define DECODE_CONFIG_SUFFIX ".cfg"
+// outputs an output order can name, the 9 of a YOLOv8 export with score sums fit
+#define DECODE_CONFIG_MAX_OUTPUTS 16
+
+/**
+ * @brief Decode settings of a model; 0 or unset fields fall back to the YOLOv5 defaults
+ *        and to what the output attrs tell
+ *
+ */
+typedef struct decode_config {
+    int anchors[3][6];      // w/h of the 3 anchors of each anchor-based head, the stride 8 head first
+    int strides[3];         // model pixels per cell of each head, 0: model size / grid size on each axis
+    int num_classes;        // 0: from the output channels
+    int pad_color;          // letterbox fill of the 3 channels
+    int num_outputs;        // entries of output_order, 0: the runtime order
+    int output_order[DECODE_CONFIG_MAX_OUTPUTS];    // runtime index of the output read as slot i
+} decode_config_t;
+
+/**
+ * @brief Fill the settings of the stock YOLOv5 models
+ *
+ * @param config [out] Config
+ */
+void default_decode_config(decode_config_t *config);
+
+/**
+ * @brief Merge the keys of a config text into config
+ *
+ * @param text [in] Config text
+ * @param config [in/out] Config, keys not in text keep their value
+ * @return int 0: success; -1: a malformed value
+ */
+int parse_decode_config(const char *text, decode_config_t *config);
+
+/**
+ * @brief Build the config of a loaded model: defaults, then the custom string, then the sidecar file
+ *
+ * @param ctx [in] RKNN context of the model
+ * @param model_path [in] Path the model was read from, locates the sidecar
+ * @param config [out] Config
+ * @return int 0: success; -1: a malformed config
+ */
+int load_decode_config(rknn_context ctx, const char *model_path, decode_config_t *config);
+
+/**
+ * @brief Reorder queried output attrs into the slots of config->output_order; attr.index keeps
+ *        the runtime index, so outputs fetched by it land in the reordered slots
+ *
+ * @param config [in] Config
+ * @param output_attrs [in/out] n_output attrs in runtime order
+ * @param n_output [in] Output count
+ * @return int 0: success; -1: the order is not a permutation of the outputs
+ */
+int reorder_output_attrs(const decode_config_t *config, rknn_tensor_attr *output_attrs, int n_output);
+
+/**
+ * @brief Config of a model context, the defaults when none was loaded
+ *
+ * @param app_ctx [in] Model context
+ * @return const decode_config_t* config
+ */
+const decode_config_t *yolov5_decode_config(const rknn_app_context_t *app_ctx);
+
+#endif //_RKNN_YOLOV5_DEMO_DECODE_CONFIG_H_
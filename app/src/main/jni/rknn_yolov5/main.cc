@@ -7,6 +7,7 @@
 #include <string.h>
 
 #include "yolov5.h"
+#include "tensor_record.h"
 #include "utils/image_utils.h"
 #include "utils/file_utils.h"
 #include "utils/image_drawing.h"
@@ -18,9 +19,9 @@
 -------------------------------------------*/
 int main(int argc, char **argv)
 {
-    if (argc != 3)
+    if (argc != 3 && argc != 4)
     {
-        printf("%s <model_path> <image_path>\n", argv[0]);
+        printf("%s <model_path> <image_path> [record_path]\n", argv[0]);
         return -1;
     }
 
@@ -40,6 +41,11 @@ int main(int argc, char **argv)
         goto out;
     }
 
+    if (argc == 4 && tensor_record_start(&rknn_app_ctx, argv[3]) != 0)
+    {
+        printf("tensor_record_start fail! record_path=%s\n", argv[3]);
+    }
+
     image_buffer_t src_image;
     memset(&src_image, 0, sizeof(image_buffer_t));
     ret = read_image(image_path, &src_image);
@@ -52,7 +58,7 @@ int main(int argc, char **argv)
 
     object_detect_result_list od_results;
 
-    ret = inference_yolov5_model(&rknn_app_ctx, &src_image, &od_results);
+    ret = inference_yolov5_model(&rknn_app_ctx, &src_image, NULL, &od_results);
     if (ret != 0)
     {
         printf("init_yolov5_model fail! ret=%d\n", ret);
@@ -13,6 +13,10 @@
 // limitations under the License.
 
 #include "yolov5.h"
+#include "postprocess_internal.h"
+#include "decode_config.h"
+#include "utils/thread_pool.h"
+#include "Float16.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -21,14 +25,31 @@
 #include <string.h>
 #include <sys/time.h>
 
-#include <set>
+#include <algorithm>
 #include <vector>
 
-static char *labels[OBJ_CLASS_NUM];
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define POSTPROCESS_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define POSTPROCESS_SSE2
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define POSTPROCESS_AVX2
+#endif
+#endif
 
-const int anchor[3][6] = {{10,  13, 16,  30,  33,  23},
-                          {30,  61, 62,  45,  59,  119},
-                          {116, 90, 156, 198, 373, 326}};
+// cells of an objectness plane scanned per candidate batch
+#define SCAN_BLOCK 256
+
+// nms_grid cell size in model pixels, the most cells per grid side, and the most
+// (cell, kept box) entries
+#define NMS_GRID_CELL 32
+#define NMS_GRID_MAX_COLS 32
+#define NMS_GRID_ENTRIES 2048
+
+static char *labels[OBJ_CLASS_MAX];
 
 inline static int clamp(float val, int min, int max) {
     return val > min ? (val < max ? val : max) : min;
@@ -89,87 +110,365 @@ static int readLines(const char *fileName, char *lines[], int max_line) {
 
 static int loadLabelName(const char *locationFilename, char *label[]) {
     printf("load lable %s\n", locationFilename);
-    readLines(locationFilename, label, OBJ_CLASS_NUM);
+    readLines(locationFilename, label, OBJ_CLASS_MAX);
     return 0;
 }
 
-static float
-CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1,
-                 float xmax1,
-                 float ymax1) {
-    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
-    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
-    float i = w * h;
-    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) +
-              (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
-    return u <= 0.f ? 0.f : (i / u);
+// Boxes kept by nms() so far, the fields of one box at the same index
+typedef struct {
+    int count;
+    float x1[OBJ_NUMB_MAX_SIZE];
+    float y1[OBJ_NUMB_MAX_SIZE];
+    float x2[OBJ_NUMB_MAX_SIZE];
+    float y2[OBJ_NUMB_MAX_SIZE];
+    float area[OBJ_NUMB_MAX_SIZE];
+    int cls[OBJ_NUMB_MAX_SIZE];
+} nms_kept_t;
+
+// IoU > threshold is tested as inter > threshold * union, armv7 NEON has no division;
+// boxes are inclusive pixel ranges, a union <= 0 never overlaps
+static inline int overlaps_one(const nms_kept_t *kept, int k, float x1, float y1, float x2, float y2,
+                               float area, float threshold) {
+    float w = fmaxf(0.f, fminf(x2, kept->x2[k]) - fmaxf(x1, kept->x1[k]) + 1.f);
+    float h = fmaxf(0.f, fminf(y2, kept->y2[k]) - fmaxf(y1, kept->y1[k]) + 1.f);
+    float inter = w * h;
+    float uni = area + kept->area[k] - inter;
+    return uni > 0.f && inter > threshold * uni;
 }
 
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds,
-               std::vector<int> &order,
-               int filterId, float threshold) {
-    for (int i = 0; i < validCount; ++i) {
-        if (order[i] == -1 || classIds[i] != filterId) {
-            continue;
+// 1 when a kept box of class cls overlaps the box above threshold
+static int overlaps_kept(const nms_kept_t *kept, float x1, float y1, float x2, float y2, float area,
+                         int cls, float threshold) {
+    int k = 0;
+    int n = kept->count;
+#if defined(POSTPROCESS_AVX2)
+    {
+        const __m256 vx1 = _mm256_set1_ps(x1), vy1 = _mm256_set1_ps(y1);
+        const __m256 vx2 = _mm256_set1_ps(x2), vy2 = _mm256_set1_ps(y2);
+        const __m256 varea = _mm256_set1_ps(area), vthr = _mm256_set1_ps(threshold);
+        const __m256 one = _mm256_set1_ps(1.f), zero = _mm256_setzero_ps();
+        const __m256i vcls = _mm256_set1_epi32(cls);
+        for (; k + 8 <= n; k += 8) {
+            __m256 w = _mm256_sub_ps(_mm256_min_ps(vx2, _mm256_loadu_ps(kept->x2 + k)),
+                                     _mm256_max_ps(vx1, _mm256_loadu_ps(kept->x1 + k)));
+            __m256 h = _mm256_sub_ps(_mm256_min_ps(vy2, _mm256_loadu_ps(kept->y2 + k)),
+                                     _mm256_max_ps(vy1, _mm256_loadu_ps(kept->y1 + k)));
+            w = _mm256_max_ps(zero, _mm256_add_ps(w, one));
+            h = _mm256_max_ps(zero, _mm256_add_ps(h, one));
+            __m256 inter = _mm256_mul_ps(w, h);
+            __m256 uni = _mm256_sub_ps(_mm256_add_ps(varea, _mm256_loadu_ps(kept->area + k)), inter);
+            __m256 hit = _mm256_and_ps(_mm256_cmp_ps(uni, zero, _CMP_GT_OQ),
+                                       _mm256_cmp_ps(inter, _mm256_mul_ps(vthr, uni), _CMP_GT_OQ));
+            __m256i same = _mm256_cmpeq_epi32(vcls, _mm256_loadu_si256((const __m256i *) (kept->cls + k)));
+            if (_mm256_movemask_ps(_mm256_and_ps(hit, _mm256_castsi256_ps(same))) != 0) {
+                return 1;
+            }
         }
-        int n = order[i];
-        for (int j = i + 1; j < validCount; ++j) {
-            int m = order[j];
-            if (m == -1 || classIds[i] != filterId) {
-                continue;
+    }
+#endif
+#if defined(POSTPROCESS_SSE2)
+    {
+        const __m128 vx1 = _mm_set1_ps(x1), vy1 = _mm_set1_ps(y1);
+        const __m128 vx2 = _mm_set1_ps(x2), vy2 = _mm_set1_ps(y2);
+        const __m128 varea = _mm_set1_ps(area), vthr = _mm_set1_ps(threshold);
+        const __m128 one = _mm_set1_ps(1.f), zero = _mm_setzero_ps();
+        const __m128i vcls = _mm_set1_epi32(cls);
+        for (; k + 4 <= n; k += 4) {
+            __m128 w = _mm_sub_ps(_mm_min_ps(vx2, _mm_loadu_ps(kept->x2 + k)),
+                                  _mm_max_ps(vx1, _mm_loadu_ps(kept->x1 + k)));
+            __m128 h = _mm_sub_ps(_mm_min_ps(vy2, _mm_loadu_ps(kept->y2 + k)),
+                                  _mm_max_ps(vy1, _mm_loadu_ps(kept->y1 + k)));
+            w = _mm_max_ps(zero, _mm_add_ps(w, one));
+            h = _mm_max_ps(zero, _mm_add_ps(h, one));
+            __m128 inter = _mm_mul_ps(w, h);
+            __m128 uni = _mm_sub_ps(_mm_add_ps(varea, _mm_loadu_ps(kept->area + k)), inter);
+            __m128 hit = _mm_and_ps(_mm_cmpgt_ps(uni, zero), _mm_cmpgt_ps(inter, _mm_mul_ps(vthr, uni)));
+            __m128i same = _mm_cmpeq_epi32(vcls, _mm_loadu_si128((const __m128i *) (kept->cls + k)));
+            if (_mm_movemask_ps(_mm_and_ps(hit, _mm_castsi128_ps(same))) != 0) {
+                return 1;
             }
-            float xmin0 = outputLocations[n * 4 + 0];
-            float ymin0 = outputLocations[n * 4 + 1];
-            float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
-            float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
+        }
+    }
+#elif defined(POSTPROCESS_NEON)
+    {
+        const float32x4_t vx1 = vdupq_n_f32(x1), vy1 = vdupq_n_f32(y1);
+        const float32x4_t vx2 = vdupq_n_f32(x2), vy2 = vdupq_n_f32(y2);
+        const float32x4_t varea = vdupq_n_f32(area), vthr = vdupq_n_f32(threshold);
+        const float32x4_t one = vdupq_n_f32(1.f), zero = vdupq_n_f32(0.f);
+        const int32x4_t vcls = vdupq_n_s32(cls);
+        for (; k + 4 <= n; k += 4) {
+            float32x4_t w = vsubq_f32(vminq_f32(vx2, vld1q_f32(kept->x2 + k)),
+                                      vmaxq_f32(vx1, vld1q_f32(kept->x1 + k)));
+            float32x4_t h = vsubq_f32(vminq_f32(vy2, vld1q_f32(kept->y2 + k)),
+                                      vmaxq_f32(vy1, vld1q_f32(kept->y1 + k)));
+            w = vmaxq_f32(zero, vaddq_f32(w, one));
+            h = vmaxq_f32(zero, vaddq_f32(h, one));
+            float32x4_t inter = vmulq_f32(w, h);
+            float32x4_t uni = vsubq_f32(vaddq_f32(varea, vld1q_f32(kept->area + k)), inter);
+            uint32x4_t hit = vandq_u32(vcgtq_f32(uni, zero), vcgtq_f32(inter, vmulq_f32(vthr, uni)));
+            hit = vandq_u32(hit, vceqq_s32(vcls, vld1q_s32(kept->cls + k)));
+            uint32x2_t any = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+            if (vget_lane_u64(vreinterpret_u64_u32(any), 0) != 0) {
+                return 1;
+            }
+        }
+    }
+#endif
+    for (; k < n; k++) {
+        if (kept->cls[k] == cls && overlaps_one(kept, k, x1, y1, x2, y2, area, threshold)) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-            float xmin1 = outputLocations[m * 4 + 0];
-            float ymin1 = outputLocations[m * 4 + 1];
-            float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
-            float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
+int nms(const nms_boxes_t *boxes, float threshold, int max_keep, int *keep) {
+    nms_kept_t kept;
+    kept.count = 0;
+    if (max_keep > OBJ_NUMB_MAX_SIZE) {
+        max_keep = OBJ_NUMB_MAX_SIZE;
+    }
+    // greedy in score order: a box survives when no kept box of its class overlaps it,
+    // later boxes can not change the kept ones so the scan stops at max_keep
+    for (int i = 0; i < boxes->count && kept.count < max_keep; i++) {
+        int n = boxes->order != NULL ? boxes->order[i] : i;
+        float x1 = boxes->x1[n];
+        float y1 = boxes->y1[n];
+        float x2 = boxes->x2[n];
+        float y2 = boxes->y2[n];
+        float area = boxes->area[n];
+        int cls = boxes->cls[n];
+        if (overlaps_kept(&kept, x1, y1, x2, y2, area, cls, threshold)) {
+            continue;
+        }
+        int k = kept.count++;
+        kept.x1[k] = x1;
+        kept.y1[k] = y1;
+        kept.x2[k] = x2;
+        kept.y2[k] = y2;
+        kept.area[k] = area;
+        kept.cls[k] = cls;
+        keep[k] = n;
+    }
+    return kept.count;
+}
 
-            float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
+// Boxes intersect only when each one's x1 lies below the other's x2 + 1, so two boxes that
+// intersect share the cell of the larger x1 (and y1) when each covers [x1, x2 + 1].
+static inline int grid_cell_of(float v, float inv_cell, int cells) {
+    float f = v * inv_cell;
+    if (!(f > 0.f)) {
+        return 0;
+    }
+    return f >= (float) cells ? cells - 1 : (int) f;
+}
 
-            if (iou > threshold) {
-                order[j] = -1;
-            }
+// 1 when a kept box listed in the cell is of class cls and overlaps the box above threshold
+static inline int overlaps_cell(const nms_kept_t *kept, int entry, const int16_t *entry_box,
+                                const int16_t *entry_next, float x1, float y1, float x2, float y2,
+                                float area, int cls, float threshold) {
+    for (; entry >= 0; entry = entry_next[entry]) {
+        int k = entry_box[entry];
+        if (kept->cls[k] == cls && overlaps_one(kept, k, x1, y1, x2, y2, area, threshold)) {
+            return 1;
         }
     }
     return 0;
 }
 
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right,
-                                     std::vector<int> &indices) {
-    float key;
-    int key_index;
-    int low = left;
-    int high = right;
-    if (left < right) {
-        key_index = indices[left];
-        key = input[left];
-        while (low < high) {
-            while (low < high && input[high] <= key) {
-                high--;
+int nms_grid(const nms_boxes_t *boxes, float threshold, int max_keep, int grid_width,
+             int grid_height, int *keep) {
+    if (threshold < 0.f || grid_width <= 0 || grid_height <= 0) {
+        // boxes that do not intersect still pass inter > threshold * union
+        return nms(boxes, threshold, max_keep, keep);
+    }
+    int cell = NMS_GRID_CELL;
+    int span = grid_width > grid_height ? grid_width : grid_height;
+    if (span > cell * NMS_GRID_MAX_COLS) {
+        cell = (span + NMS_GRID_MAX_COLS - 1) / NMS_GRID_MAX_COLS;
+    }
+    int cols = (grid_width + cell - 1) / cell;
+    int rows = (grid_height + cell - 1) / cell;
+    float inv_cell = 1.f / (float) cell;
+
+    nms_kept_t kept;
+    kept.count = 0;
+    // per-cell lists of kept boxes; boxes that no longer fit the entry pool go to a
+    // list every candidate tests
+    int16_t head[NMS_GRID_MAX_COLS * NMS_GRID_MAX_COLS];
+    int16_t entry_box[NMS_GRID_ENTRIES];
+    int16_t entry_next[NMS_GRID_ENTRIES];
+    int16_t spill[OBJ_NUMB_MAX_SIZE];
+    int num_entries = 0;
+    int num_spill = 0;
+    for (int c = 0; c < cols * rows; c++) {
+        head[c] = -1;
+    }
+    if (max_keep > OBJ_NUMB_MAX_SIZE) {
+        max_keep = OBJ_NUMB_MAX_SIZE;
+    }
+
+    for (int i = 0; i < boxes->count && kept.count < max_keep; i++) {
+        int n = boxes->order != NULL ? boxes->order[i] : i;
+        float x1 = boxes->x1[n];
+        float y1 = boxes->y1[n];
+        float x2 = boxes->x2[n];
+        float y2 = boxes->y2[n];
+        float area = boxes->area[n];
+        int cls = boxes->cls[n];
+        int cx0 = grid_cell_of(x1, inv_cell, cols);
+        int cx1 = grid_cell_of(x2 + 1.f, inv_cell, cols);
+        int cy0 = grid_cell_of(y1, inv_cell, rows);
+        int cy1 = grid_cell_of(y2 + 1.f, inv_cell, rows);
+
+        int suppressed = 0;
+        for (int s = 0; s < num_spill && !suppressed; s++) {
+            int k = spill[s];
+            suppressed = kept.cls[k] == cls && overlaps_one(&kept, k, x1, y1, x2, y2, area, threshold);
+        }
+        for (int cy = cy0; cy <= cy1 && !suppressed; cy++) {
+            for (int cx = cx0; cx <= cx1 && !suppressed; cx++) {
+                suppressed = overlaps_cell(&kept, head[cy * cols + cx], entry_box, entry_next, x1, y1,
+                                           x2, y2, area, cls, threshold);
             }
-            input[low] = input[high];
-            indices[low] = indices[high];
-            while (low < high && input[low] >= key) {
-                low++;
+        }
+        if (suppressed) {
+            continue;
+        }
+
+        int k = kept.count++;
+        kept.x1[k] = x1;
+        kept.y1[k] = y1;
+        kept.x2[k] = x2;
+        kept.y2[k] = y2;
+        kept.area[k] = area;
+        kept.cls[k] = cls;
+        keep[k] = n;
+        if (num_entries + (cx1 - cx0 + 1) * (cy1 - cy0 + 1) > NMS_GRID_ENTRIES) {
+            spill[num_spill++] = (int16_t) k;
+            continue;
+        }
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                int c = cy * cols + cx;
+                entry_box[num_entries] = (int16_t) k;
+                entry_next[num_entries] = head[c];
+                head[c] = (int16_t) num_entries++;
             }
-            input[high] = input[low];
-            indices[high] = indices[low];
         }
-        input[low] = key;
-        indices[low] = key_index;
-        quick_sort_indice_inverse(input, left, low - 1, indices);
-        quick_sort_indice_inverse(input, low + 1, right, indices);
     }
-    return low;
+    return kept.count;
+}
+
+// best first, equal scores in index order
+struct score_greater {
+    const float *scores;
+
+    bool operator()(int a, int b) const {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    }
+};
+
+int topk_indices(const float *scores, int count, int k, int *order) {
+    if (k <= 0 || k > count) {
+        k = count;
+    }
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    score_greater greater = {scores};
+    if (k < count) {
+        std::nth_element(order, order + k, order + count, greater);
+    }
+    std::sort(order, order + k, greater);
+    return k;
 }
 
-static float sigmoid(float x) { return 1.0 / (1.0 + expf(-x)); }
+int radix_topk_indices(const uint32_t *score_keys, int count, int k, int *order, uint32_t *scratch) {
+    if (k <= 0 || k > count) {
+        k = count;
+    }
+    uint32_t *keys = scratch;
+    uint32_t *keys_tmp = scratch + count;
+    int *src = order;
+    int *dst = (int *) (scratch + 2 * count);
+    int hist[4][256];
+    memset(hist, 0, sizeof(hist));
+    for (int i = 0; i < count; i++) {
+        uint32_t key = score_keys[i];
+        keys[i] = key;
+        src[i] = i;
+        hist[0][key & 0xff]++;
+        hist[1][(key >> 8) & 0xff]++;
+        hist[2][(key >> 16) & 0xff]++;
+        hist[3][key >> 24]++;
+    }
 
-static float unsigmoid(float y) { return -1.0 * logf((1.0 / y) - 1.0); }
+    // keys share the digits above the top varying one; the best k lie in the buckets of that
+    // digit up to the one holding the k-th key, only those are sorted
+    int n = count;
+    int top = 3;
+    while (top > 0 && hist[top][(keys[0] >> (top * 8)) & 0xff] == count) {
+        top--;
+    }
+    if (k < count) {
+        int shift = top * 8;
+        int bucket = 0;
+        for (int sum = 0; sum + hist[top][bucket] < k; bucket++) {
+            sum += hist[top][bucket];
+        }
+        n = 0;
+        for (int i = 0; i < count; i++) {
+            if ((int) ((keys[i] >> shift) & 0xff) <= bucket) {
+                keys_tmp[n] = keys[i];
+                dst[n++] = i;
+            }
+        }
+        memset(hist, 0, (top + 1) * sizeof(hist[0]));
+        for (int i = 0; i < n; i++) {
+            uint32_t key = keys_tmp[i];
+            for (int pass = 0; pass <= top; pass++) {
+                hist[pass][(key >> (pass * 8)) & 0xff]++;
+            }
+        }
+        uint32_t *t = keys;
+        keys = keys_tmp;
+        keys_tmp = t;
+        int *o = src;
+        src = dst;
+        dst = o;
+    }
+
+    // LSD, 8 bits a pass; a pass where every key has the same digit moves nothing
+    for (int pass = 0; pass <= top && n > 1; pass++) {
+        int shift = pass * 8;
+        int *offset = hist[pass];
+        if (offset[(keys[0] >> shift) & 0xff] == n) {
+            continue;
+        }
+        int sum = 0;
+        for (int d = 0; d < 256; d++) {
+            int c = offset[d];
+            offset[d] = sum;
+            sum += c;
+        }
+        for (int i = 0; i < n; i++) {
+            int pos = offset[(keys[i] >> shift) & 0xff]++;
+            keys_tmp[pos] = keys[i];
+            dst[pos] = src[i];
+        }
+        uint32_t *t = keys;
+        keys = keys_tmp;
+        keys_tmp = t;
+        int *o = src;
+        src = dst;
+        dst = o;
+    }
+    if (src != order) {
+        memcpy(order, src, k * sizeof(int));
+    }
+    return k;
+}
 
 inline static int32_t __clip(float val, float min, float max) {
     float f = val <= min ? min : (val >= max ? max : val);
@@ -186,238 +485,1320 @@ static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) {
     return ((float) qnt - (float) zp) * scale;
 }
 
+#if defined(POSTPROCESS_SSE2)
+// append base + bit index of every set bit of mask
+static inline int append_mask(uint32_t mask, int base, int *indices, int count) {
+    while (mask != 0) {
+        indices[count++] = base + __builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+    return count;
+}
+#endif
+
+// indices of the bytes of plane[0, len) that are >= thres, returns the count
+static int scan_ge_i8(const int8_t *plane, int len, int8_t thres, int *indices) {
+    int count = 0;
+    int i = 0;
+#if defined(POSTPROCESS_AVX2)
+    const __m256i t32 = _mm256_set1_epi8(thres);
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (plane + i));
+        // v >= t  <=>  max(v, t) == v
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epi8(v, t32), v));
+        count = append_mask(mask, i, indices, count);
+    }
+#endif
+#if defined(POSTPROCESS_SSE2)
+    const __m128i t16 = _mm_set1_epi8(thres);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (plane + i));
+        // SSE2 has no signed byte max, v >= t  <=>  !(t > v)
+        uint32_t mask = ~(uint32_t) _mm_movemask_epi8(_mm_cmpgt_epi8(t16, v)) & 0xffff;
+        count = append_mask(mask, i, indices, count);
+    }
+#elif defined(POSTPROCESS_NEON)
+    const int8x16_t t16 = vdupq_n_s8(thres);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t ge = vcgeq_s8(vld1q_s8(plane + i), t16);
+        // candidates are rare, only look at the bytes of a block with a hit
+        uint8x8_t any = vorr_u8(vget_low_u8(ge), vget_high_u8(ge));
+        if (vget_lane_u64(vreinterpret_u64_u8(any), 0) == 0) {
+            continue;
+        }
+        for (int k = i; k < i + 16; k++) {
+            if (plane[k] >= thres) {
+                indices[count++] = k;
+            }
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (plane[i] >= thres) {
+            indices[count++] = i;
+        }
+    }
+    return count;
+}
+
+// fp16 bits mapped to an int16 of the same order, -0 and +0 equal; heads carry no NaN
+static inline int16_t f16_key(uint16_t h) {
+    int sign = -(h >> 15);
+    return (int16_t) (((h & 0x7fff) ^ sign) - sign);
+}
+
+static inline float f16_to_f32(uint16_t h) {
+    return (float) rknpu2::float16::fromBits(h);
+}
+
+static inline float f16_key_to_f32(int key) {
+    return f16_to_f32((uint16_t) (key >= 0 ? key : 0x8000 | -key));
+}
+
+// smallest key of the halves >= threshold, > threshold when strict; 0x7c01 (past +inf) for none
+static int16_t f16_threshold_key(float threshold, bool strict) {
+    // the conversion rounds to nearest, step to the first half on the passing side
+    int key = f16_key(rknpu2::float16::bits(threshold));
+    while (key > -0x7c00 && (strict ? f16_key_to_f32(key - 1) > threshold
+                                    : f16_key_to_f32(key - 1) >= threshold)) {
+        key--;
+    }
+    while (key <= 0x7c00 && !(strict ? f16_key_to_f32(key) > threshold : f16_key_to_f32(key) >= threshold)) {
+        key++;
+    }
+    return (int16_t) key;
+}
+
+// key of a half compared against a floor key; above a positive floor every negative half
+// fails and the raw bits of the others already sort as their keys
+template<bool POSITIVE>
+static inline int16_t f16_floor_key(uint16_t h) {
+    return POSITIVE ? (int16_t) h : f16_key(h);
+}
+
+// first largest class of p[c * step], over the class_ids when given, else the nc classes
+template<bool POSITIVE>
+static inline int argmax_f16(const uint16_t *p, int step, int nc, const int *class_ids, int num_class_ids,
+                             int16_t *max_key) {
+    int n = class_ids != NULL ? num_class_ids : nc;
+    int best = class_ids != NULL ? class_ids[0] : 0;
+    int16_t m = f16_floor_key<POSITIVE>(p[best * step]);
+    for (int k = 1; k < n; ++k) {
+        int c = class_ids != NULL ? class_ids[k] : k;
+        int16_t key = f16_floor_key<POSITIVE>(p[c * step]);
+        if (key > m) {
+            best = c;
+            m = key;
+        }
+    }
+    *max_key = m;
+    return best;
+}
+
+#if defined(POSTPROCESS_SSE2)
+// append the elements of a movemask of 16-bit lanes, two bits per lane
+static inline int append_mask16(uint32_t mask, int base, int *indices, int count) {
+    mask &= 0x55555555u;
+    while (mask != 0) {
+        indices[count++] = base + (__builtin_ctz(mask) >> 1);
+        mask &= mask - 1;
+    }
+    return count;
+}
+#endif
+
+// indices of the halves of plane[0, len) whose key is >= min_key, returns the count
+static int scan_ge_f16(const uint16_t *plane, int len, int16_t min_key, int *indices) {
+    int count = 0;
+    int i = 0;
+#if defined(POSTPROCESS_AVX2)
+    const __m256i m32 = _mm256_set1_epi16(min_key);
+    const __m256i abs32 = _mm256_set1_epi16(0x7fff);
+    for (; i + 16 <= len; i += 16) {
+        __m256i h = _mm256_loadu_si256((const __m256i *) (plane + i));
+        // key: the magnitude, negated for the negative halves
+        __m256i sign = _mm256_srai_epi16(h, 15);
+        __m256i key = _mm256_sub_epi16(_mm256_xor_si256(_mm256_and_si256(h, abs32), sign), sign);
+        uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi16(m32, key));
+        count = append_mask16(mask, i, indices, count);
+    }
+#endif
+#if defined(POSTPROCESS_SSE2)
+    const __m128i m16 = _mm_set1_epi16(min_key);
+    const __m128i abs16 = _mm_set1_epi16(0x7fff);
+    for (; i + 8 <= len; i += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i *) (plane + i));
+        __m128i sign = _mm_srai_epi16(h, 15);
+        __m128i key = _mm_sub_epi16(_mm_xor_si128(_mm_and_si128(h, abs16), sign), sign);
+        uint32_t mask = ~(uint32_t) _mm_movemask_epi8(_mm_cmpgt_epi16(m16, key)) & 0xffff;
+        count = append_mask16(mask, i, indices, count);
+    }
+#elif defined(POSTPROCESS_NEON)
+    const int16x8_t m16 = vdupq_n_s16(min_key);
+    const int16x8_t abs16 = vdupq_n_s16(0x7fff);
+    for (; i + 8 <= len; i += 8) {
+        int16x8_t h = vreinterpretq_s16_u16(vld1q_u16(plane + i));
+        int16x8_t sign = vshrq_n_s16(h, 15);
+        int16x8_t key = vsubq_s16(veorq_s16(vandq_s16(h, abs16), sign), sign);
+        uint16x8_t ge = vcgeq_s16(key, m16);
+        // candidates are rare, only look at the halves of a block with a hit
+        uint16x4_t any = vorr_u16(vget_low_u16(ge), vget_high_u16(ge));
+        if (vget_lane_u64(vreinterpret_u64_u16(any), 0) == 0) {
+            continue;
+        }
+        for (int k = i; k < i + 8; k++) {
+            if (f16_key(plane[k]) >= min_key) {
+                indices[count++] = k;
+            }
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (f16_key(plane[i]) >= min_key) {
+            indices[count++] = i;
+        }
+    }
+    return count;
+}
+
+// index of the first largest of the contiguous p[0, n), its value in *max_value
+static int argmax_i8(const int8_t *p, int n, int8_t *max_value) {
+    int8_t m = p[0];
+    int k = 1;
+    if (n >= 16) {
+        int8_t lanes[16];
+#if defined(POSTPROCESS_SSE2)
+        // SSE2 only has an unsigned byte max, flip the sign bit to keep the order
+        const __m128i sign = _mm_set1_epi8((char) 0x80);
+        __m128i vmax = _mm_xor_si128(_mm_loadu_si128((const __m128i *) p), sign);
+        for (k = 16; k + 16 <= n; k += 16) {
+            vmax = _mm_max_epu8(vmax, _mm_xor_si128(_mm_loadu_si128((const __m128i *) (p + k)), sign));
+        }
+        _mm_storeu_si128((__m128i *) lanes, _mm_xor_si128(vmax, sign));
+#elif defined(POSTPROCESS_NEON)
+        int8x16_t vmax = vld1q_s8(p);
+        for (k = 16; k + 16 <= n; k += 16) {
+            vmax = vmaxq_s8(vmax, vld1q_s8(p + k));
+        }
+        vst1q_s8(lanes, vmax);
+#else
+        memcpy(lanes, p, 16);
+        k = 16;
+#endif
+        for (int l = 0; l < 16; l++) {
+            m = lanes[l] > m ? lanes[l] : m;
+        }
+    }
+    for (; k < n; k++) {
+        m = p[k] > m ? p[k] : m;
+    }
+    *max_value = m;
+    // the first one wins ties, like the scalar scan did
+    for (k = 0; p[k] != m; k++) {
+    }
+    return k;
+}
+
+// integer score floor of the quantized product (obj - zp) * (cls - zp): products at or below
+// it can not dequantize above threshold. products above still get the exact float check.
+static int32_t score_floor_i32(float threshold, float scale) {
+    double q = floor((double) threshold / ((double) scale * scale)) - 1;
+    // |(obj - zp) * (cls - zp)| <= 255 * 255
+    q = q < -70000 ? -70000 : (q > 70000 ? 70000 : q);
+    return (int32_t) q;
+}
+
+// append a decoded box, given by its top-left corner and size, to the candidate columns
+static inline void push_candidate(candidate_arena_t *cand, float box_x, float box_y, float box_w,
+                                  float box_h, float score, int cls) {
+    int n = cand->count++;
+    float x2 = box_x + box_w;
+    float y2 = box_y + box_h;
+    cand->x1[n] = box_x;
+    cand->y1[n] = box_y;
+    cand->x2[n] = x2;
+    cand->y2[n] = y2;
+    cand->area[n] = (x2 - box_x + 1.f) * (y2 - box_y + 1.f);
+    cand->score[n] = score;
+    cand->cls[n] = cls;
+    cand->qscore[n] = score_key(score);
+}
+
+// NC of the kernels decoding a class selection: the generic layout, the argmax only reads
+// the selected channels
+#define NC_SELECTED (-1)
+
+// first largest of the selected channels, channel c at p[c * step]; returns its class id
+template<typename T>
+static inline int argmax_selected(const T *p, int step, const int *class_ids, int num_class_ids, T *max_value) {
+    T m = p[class_ids[0] * step];
+    int best = class_ids[0];
+    for (int k = 1; k < num_class_ids; k++) {
+        T v = p[class_ids[k] * step];
+        if (v > m) {
+            m = v;
+            best = class_ids[k];
+        }
+    }
+    *max_value = m;
+    return best;
+}
+
+// The decode kernels are templates on the class count so the class loops of the common
+// models unroll; NC = 0 is the generic kernel reading num_classes at run time, NC_SELECTED
+// the one of a class selection (class_ids ascending, NULL otherwise). Each decodes the rows
+// and anchors of a task, appending in the order a whole-head decode would.
+template<int NC>
 static int
-process_i8(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-           std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId,
-           float threshold,
-           int32_t zp, float scale) {
+decode_i8(int8_t *input, const head_lut_t *lut, int grid_h, int grid_w, int num_classes,
+          const decode_task_t *task, candidate_arena_t *cand, float threshold,
+          const int *class_ids, int num_class_ids) {
+    const int nc = NC > 0 ? NC : num_classes;
+    const int prop_box_size = 5 + nc;
     int validCount = 0;
     int grid_len = grid_h * grid_w;
-    int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
-    for (int a = 0; a < 3; a++) {
-        for (int i = 0; i < grid_h; i++) {
-            for (int j = 0; j < grid_w; j++) {
-                int8_t box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-                if (box_confidence >= thres_i8) {
-                    int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-                    int8_t *in_ptr = input + offset;
-                    float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
-                    float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
-                    float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
-                    float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
-                    box_x = (box_x + j) * (float) stride;
-                    box_y = (box_y + i) * (float) stride;
-                    box_w = box_w * box_w * (float) anchor[a * 2];
-                    box_h = box_h * box_h * (float) anchor[a * 2 + 1];
-                    box_x -= (box_w / 2.0);
-                    box_y -= (box_h / 2.0);
+    int cell_end = task->row_end * grid_w;
+    float stride_x = (float) lut->stride_x;
+    float stride_y = (float) lut->stride_y;
+    int8_t thres_i8 = qnt_f32_to_affine(threshold, lut->zp, lut->scale);
+    int cells[SCAN_BLOCK];
+    for (int a = task->anchor_begin; a < task->anchor_end; a++) {
+        // the objectness of an anchor is one contiguous plane, find the candidates in it first
+        const int8_t *conf_plane = input + (prop_box_size * a + 4) * grid_len;
+        for (int block = task->row_begin * grid_w; block < cell_end; block += SCAN_BLOCK) {
+            int block_len = cell_end - block < SCAN_BLOCK ? cell_end - block : SCAN_BLOCK;
+            int num_cells = scan_ge_i8(conf_plane + block, block_len, thres_i8, cells);
+            for (int c = 0; c < num_cells; c++) {
+                int cell = block + cells[c];
+                int i = cell / grid_w;
+                int j = cell - i * grid_w;
+                int8_t box_confidence = conf_plane[cell];
+                int offset = (prop_box_size * a) * grid_len + cell;
+                int8_t *in_ptr = input + offset;
 
-                    int8_t maxClassProbs = in_ptr[5 * grid_len];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k) {
+                // class argmax and threshold stay in int8, floats only for the survivors
+                int8_t maxClassProbs = in_ptr[5 * grid_len];
+                int maxClassId = 0;
+                if (NC == NC_SELECTED) {
+                    maxClassId = argmax_selected(in_ptr + 5 * grid_len, grid_len, class_ids, num_class_ids,
+                                                 &maxClassProbs);
+                } else {
+                    for (int k = 1; k < nc; ++k) {
                         int8_t prob = in_ptr[(5 + k) * grid_len];
                         if (prob > maxClassProbs) {
                             maxClassId = k;
                             maxClassProbs = prob;
                         }
                     }
-                    if (maxClassProbs > thres_i8) {
-                        objProbs.push_back((deqnt_affine_to_f32(maxClassProbs, zp, scale)) *
-                                           (deqnt_affine_to_f32(box_confidence, zp, scale)));
-                        classId.push_back(maxClassId);
-                        validCount++;
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
-                    }
                 }
+                if (maxClassProbs <= thres_i8) {
+                    continue;
+                }
+
+                float box_x = (lut->xy[*in_ptr + 128] + j) * stride_x;
+                float box_y = (lut->xy[in_ptr[grid_len] + 128] + i) * stride_y;
+                float box_w = lut->wh[a][0][in_ptr[2 * grid_len] + 128];
+                float box_h = lut->wh[a][1][in_ptr[3 * grid_len] + 128];
+                box_x -= (box_w / 2.0);
+                box_y -= (box_h / 2.0);
+
+                push_candidate(cand, box_x, box_y, box_w, box_h,
+                               lut->score[maxClassProbs + 128] * lut->score[box_confidence + 128],
+                               maxClassId);
+                validCount++;
             }
         }
     }
     return validCount;
 }
 
+template<int NC>
 static int
-process_i8_rv1106(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width,
-                  int stride,
-                  std::vector<float> &boxes, std::vector<float> &boxScores,
-                  std::vector<int> &classId, float threshold,
-                  int32_t zp, float scale) {
+decode_i8_rv1106(int8_t *input, const head_lut_t *lut, int /* grid_h */, int grid_w, int num_classes,
+                 const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                 const int *class_ids, int num_class_ids) {
+    const int nc = NC > 0 ? NC : num_classes;
+    const int prop_box_size = 5 + nc;
     int validCount = 0;
-    int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
+    float stride_x = (float) lut->stride_x;
+    float stride_y = (float) lut->stride_y;
+    int32_t zp = lut->zp;
+    int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, lut->scale);
+    int32_t score_floor = score_floor_i32(threshold, lut->scale);
 
     int anchor_per_branch = 3;
-    int align_c = PROP_BOX_SIZE * anchor_per_branch;
+    int align_c = prop_box_size * anchor_per_branch;
+    int row_anchors = grid_w * anchor_per_branch;
 
-    for (int h = 0; h < grid_h; h++) {
-        for (int w = 0; w < grid_w; w++) {
-            for (int a = 0; a < anchor_per_branch; a++) {
-                int hw_offset = h * grid_w * align_c + w * align_c + a * PROP_BOX_SIZE;
-                int8_t *hw_ptr = input + hw_offset;
-                int8_t box_confidence = hw_ptr[4];
-
-                if (box_confidence >= thres_i8) {
-                    int8_t maxClassProbs = hw_ptr[5];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k) {
-                        int8_t prob = hw_ptr[5 + k];
-                        if (prob > maxClassProbs) {
-                            maxClassId = k;
-                            maxClassProbs = prob;
-                        }
-                    }
-
-                    float box_conf_f32 = deqnt_affine_to_f32(box_confidence, zp, scale);
-                    float class_prob_f32 = deqnt_affine_to_f32(maxClassProbs, zp, scale);
-                    float limit_score = box_conf_f32 * class_prob_f32;
-
-                    if (limit_score > threshold) {
-                        float box_x, box_y, box_w, box_h;
-
-                        box_x = deqnt_affine_to_f32(hw_ptr[0], zp, scale) * 2.0 - 0.5;
-                        box_y = deqnt_affine_to_f32(hw_ptr[1], zp, scale) * 2.0 - 0.5;
-                        box_w = deqnt_affine_to_f32(hw_ptr[2], zp, scale) * 2.0;
-                        box_h = deqnt_affine_to_f32(hw_ptr[3], zp, scale) * 2.0;
-                        box_w = box_w * box_w;
-                        box_h = box_h * box_h;
+    for (int h = task->row_begin; h < task->row_end; h++) {
+        // the anchors of a row follow each other, prop_box_size bytes apart
+        int8_t *row = input + h * grid_w * align_c;
+        for (int k = 0; k < row_anchors; k++) {
+            int8_t *hw_ptr = row + k * prop_box_size;
+            int8_t box_confidence = hw_ptr[4];
+            if (box_confidence < thres_i8) {
+                continue;
+            }
+            int w = k / anchor_per_branch;
+            int a = k - w * anchor_per_branch;
+            if (a < task->anchor_begin || a >= task->anchor_end) {
+                continue;
+            }
 
+            // the class scores of a cell are contiguous in this layout
+            int8_t maxClassProbs;
+            int maxClassId = NC == NC_SELECTED
+                             ? argmax_selected(hw_ptr + 5, 1, class_ids, num_class_ids, &maxClassProbs)
+                             : argmax_i8(hw_ptr + 5, nc, &maxClassProbs);
+            // the box confidence times the class probability against the threshold
+            int32_t score_q = ((int32_t) box_confidence - zp) * ((int32_t) maxClassProbs - zp);
+            if (score_q <= score_floor) {
+                continue;
+            }
+            float limit_score = lut->score[box_confidence + 128] * lut->score[maxClassProbs + 128];
+            if (limit_score <= threshold) {
+                continue;
+            }
 
-                        box_x = (box_x + w) * (float) stride;
-                        box_y = (box_y + h) * (float) stride;
-                        box_w *= (float) anchor[a * 2];
-                        box_h *= (float) anchor[a * 2 + 1];
+            float box_x = (lut->xy[hw_ptr[0] + 128] + w) * stride_x;
+            float box_y = (lut->xy[hw_ptr[1] + 128] + h) * stride_y;
+            float box_w = lut->wh[a][0][hw_ptr[2] + 128];
+            float box_h = lut->wh[a][1][hw_ptr[3] + 128];
 
-                        box_x -= (box_w / 2.0);
-                        box_y -= (box_h / 2.0);
+            box_x -= (box_w / 2.0);
+            box_y -= (box_h / 2.0);
 
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
-                        boxScores.push_back(limit_score);
-                        classId.push_back(maxClassId);
-                        validCount++;
-                    }
-                }
-            }
+            push_candidate(cand, box_x, box_y, box_w, box_h, limit_score, maxClassId);
+            validCount++;
         }
     }
     return validCount;
 }
 
+template<int NC>
 static int
-process_fp32(float *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-             std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId,
-             float threshold) {
+decode_fp32(float *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+            const decode_task_t *task, candidate_arena_t *cand, float threshold,
+            const int *class_ids, int num_class_ids) {
+    const int nc = NC > 0 ? NC : num_classes;
+    const int prop_box_size = 5 + nc;
     int validCount = 0;
     int grid_len = grid_h * grid_w;
 
-    for (int a = 0; a < 3; a++) {
-        for (int i = 0; i < grid_h; i++) {
+    for (int a = task->anchor_begin; a < task->anchor_end; a++) {
+        for (int i = task->row_begin; i < task->row_end; i++) {
             for (int j = 0; j < grid_w; j++) {
-                float box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
+                float box_confidence = input[(prop_box_size * a + 4) * grid_len + i * grid_w + j];
                 if (box_confidence >= threshold) {
-                    int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
+                    int offset = (prop_box_size * a) * grid_len + i * grid_w + j;
                     float *in_ptr = input + offset;
+
+                    float maxClassProbs = in_ptr[5 * grid_len];
+                    int maxClassId = 0;
+                    if (NC == NC_SELECTED) {
+                        maxClassId = argmax_selected(in_ptr + 5 * grid_len, grid_len, class_ids, num_class_ids,
+                                                     &maxClassProbs);
+                    } else {
+                        for (int k = 1; k < nc; ++k) {
+                            float prob = in_ptr[(5 + k) * grid_len];
+                            if (prob > maxClassProbs) {
+                                maxClassId = k;
+                                maxClassProbs = prob;
+                            }
+                        }
+                    }
+                    if (!(maxClassProbs > threshold)) {
+                        continue;
+                    }
+
                     float box_x = *in_ptr * 2.0 - 0.5;
                     float box_y = in_ptr[grid_len] * 2.0 - 0.5;
                     float box_w = in_ptr[2 * grid_len] * 2.0;
                     float box_h = in_ptr[3 * grid_len] * 2.0;
-                    box_x = (box_x + j) * (float) stride;
-                    box_y = (box_y + i) * (float) stride;
+                    box_x = (box_x + j) * (float) stride_x;
+                    box_y = (box_y + i) * (float) stride_y;
                     box_w = box_w * box_w * (float) anchor[a * 2];
                     box_h = box_h * box_h * (float) anchor[a * 2 + 1];
                     box_x -= (box_w / 2.0);
                     box_y -= (box_h / 2.0);
 
-                    float maxClassProbs = in_ptr[5 * grid_len];
+                    push_candidate(cand, box_x, box_y, box_w, box_h, maxClassProbs * box_confidence,
+                                   maxClassId);
+                    validCount++;
+                }
+            }
+        }
+    }
+    return validCount;
+}
+
+template<int NC>
+static int
+decode_fp32_nhwc(float *input, int *anchor, int /* grid_h */, int grid_w, int num_classes, int stride_x, int stride_y,
+                 const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                 const int *class_ids, int num_class_ids) {
+    const int nc = NC > 0 ? NC : num_classes;
+    const int prop_box_size = 5 + nc;
+    const int align_c = prop_box_size * 3;
+    int validCount = 0;
+
+    for (int i = task->row_begin; i < task->row_end; i++) {
+        for (int j = 0; j < grid_w; j++) {
+            for (int a = task->anchor_begin; a < task->anchor_end; a++) {
+                float *in_ptr = input + (i * grid_w + j) * align_c + a * prop_box_size;
+                float box_confidence = in_ptr[4];
+                if (box_confidence >= threshold) {
+                    float maxClassProbs = in_ptr[5];
                     int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k) {
-                        float prob = in_ptr[(5 + k) * grid_len];
-                        if (prob > maxClassProbs) {
-                            maxClassId = k;
-                            maxClassProbs = prob;
+                    if (NC == NC_SELECTED) {
+                        maxClassId = argmax_selected(in_ptr + 5, 1, class_ids, num_class_ids, &maxClassProbs);
+                    } else {
+                        for (int k = 1; k < nc; ++k) {
+                            if (in_ptr[5 + k] > maxClassProbs) {
+                                maxClassId = k;
+                                maxClassProbs = in_ptr[5 + k];
+                            }
                         }
                     }
-                    if (maxClassProbs > threshold) {
-                        objProbs.push_back(maxClassProbs * box_confidence);
-                        classId.push_back(maxClassId);
-                        validCount++;
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
+                    if (!(maxClassProbs > threshold)) {
+                        continue;
                     }
+
+                    float box_x = in_ptr[0] * 2.0 - 0.5;
+                    float box_y = in_ptr[1] * 2.0 - 0.5;
+                    float box_w = in_ptr[2] * 2.0;
+                    float box_h = in_ptr[3] * 2.0;
+                    box_x = (box_x + j) * (float) stride_x;
+                    box_y = (box_y + i) * (float) stride_y;
+                    box_w = box_w * box_w * (float) anchor[a * 2];
+                    box_h = box_h * box_h * (float) anchor[a * 2 + 1];
+                    box_x -= (box_w / 2.0);
+                    box_y -= (box_h / 2.0);
+
+                    push_candidate(cand, box_x, box_y, box_w, box_h, maxClassProbs * box_confidence,
+                                   maxClassId);
+                    validCount++;
+                }
+            }
+        }
+    }
+    return validCount;
+}
+
+// fp16 heads are compared as halves, only the boxes of the survivors are converted to float
+template<int NC, bool POSITIVE>
+static int
+decode_f16_rows(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+                const decode_task_t *task, candidate_arena_t *cand, int16_t conf_min, int16_t prob_min,
+                const int *class_ids, int num_class_ids) {
+    const int nc = NC > 0 ? NC : num_classes;
+    const int prop_box_size = 5 + nc;
+    int validCount = 0;
+    int grid_len = grid_h * grid_w;
+    int cell_end = task->row_end * grid_w;
+    int cells[SCAN_BLOCK];
+    for (int a = task->anchor_begin; a < task->anchor_end; a++) {
+        const uint16_t *conf_plane = input + (prop_box_size * a + 4) * grid_len;
+        for (int block = task->row_begin * grid_w; block < cell_end; block += SCAN_BLOCK) {
+            int block_len = cell_end - block < SCAN_BLOCK ? cell_end - block : SCAN_BLOCK;
+            int num_cells = scan_ge_f16(conf_plane + block, block_len, conf_min, cells);
+            for (int c = 0; c < num_cells; c++) {
+                int cell = block + cells[c];
+                int i = cell / grid_w;
+                int j = cell - i * grid_w;
+                uint16_t *in_ptr = input + (prop_box_size * a) * grid_len + cell;
+
+                int16_t maxClassKey;
+                int maxClassId = argmax_f16<POSITIVE>(in_ptr + 5 * grid_len, grid_len, nc,
+                                                      NC == NC_SELECTED ? class_ids : NULL, num_class_ids,
+                                                      &maxClassKey);
+                if (maxClassKey < prob_min) {
+                    continue;
                 }
+
+                float box_x = f16_to_f32(in_ptr[0]) * 2.0 - 0.5;
+                float box_y = f16_to_f32(in_ptr[grid_len]) * 2.0 - 0.5;
+                float box_w = f16_to_f32(in_ptr[2 * grid_len]) * 2.0;
+                float box_h = f16_to_f32(in_ptr[3 * grid_len]) * 2.0;
+                box_x = (box_x + j) * (float) stride_x;
+                box_y = (box_y + i) * (float) stride_y;
+                box_w = box_w * box_w * (float) anchor[a * 2];
+                box_h = box_h * box_h * (float) anchor[a * 2 + 1];
+                box_x -= (box_w / 2.0);
+                box_y -= (box_h / 2.0);
+
+                push_candidate(cand, box_x, box_y, box_w, box_h,
+                               f16_to_f32(in_ptr[(5 + maxClassId) * grid_len]) * f16_to_f32(conf_plane[cell]),
+                               maxClassId);
+                validCount++;
             }
         }
     }
     return validCount;
 }
 
+template<int NC>
+static int
+decode_f16(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+           const decode_task_t *task, candidate_arena_t *cand, float threshold,
+           const int *class_ids, int num_class_ids) {
+    int16_t conf_min = f16_threshold_key(threshold, false);
+    int16_t prob_min = f16_threshold_key(threshold, true);
+    if (conf_min > 0) {
+        return decode_f16_rows<NC, true>(input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y,
+                                         task, cand, conf_min, prob_min, class_ids, num_class_ids);
+    }
+    return decode_f16_rows<NC, false>(input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y,
+                                      task, cand, conf_min, prob_min, class_ids, num_class_ids);
+}
+
+template<int NC, bool POSITIVE>
+static int
+decode_f16_nhwc_rows(uint16_t *input, int *anchor, int /* grid_h */, int grid_w, int num_classes, int stride_x, int stride_y,
+                     const decode_task_t *task, candidate_arena_t *cand, int16_t conf_min, int16_t prob_min,
+                     const int *class_ids, int num_class_ids) {
+    const int nc = NC > 0 ? NC : num_classes;
+    const int prop_box_size = 5 + nc;
+    const int align_c = prop_box_size * 3;
+    int validCount = 0;
+
+    for (int i = task->row_begin; i < task->row_end; i++) {
+        for (int j = 0; j < grid_w; j++) {
+            for (int a = task->anchor_begin; a < task->anchor_end; a++) {
+                uint16_t *in_ptr = input + (i * grid_w + j) * align_c + a * prop_box_size;
+                if (f16_floor_key<POSITIVE>(in_ptr[4]) < conf_min) {
+                    continue;
+                }
+                int16_t maxClassKey;
+                int maxClassId = argmax_f16<POSITIVE>(in_ptr + 5, 1, nc, NC == NC_SELECTED ? class_ids : NULL,
+                                                      num_class_ids, &maxClassKey);
+                if (maxClassKey < prob_min) {
+                    continue;
+                }
+
+                float box_x = f16_to_f32(in_ptr[0]) * 2.0 - 0.5;
+                float box_y = f16_to_f32(in_ptr[1]) * 2.0 - 0.5;
+                float box_w = f16_to_f32(in_ptr[2]) * 2.0;
+                float box_h = f16_to_f32(in_ptr[3]) * 2.0;
+                box_x = (box_x + j) * (float) stride_x;
+                box_y = (box_y + i) * (float) stride_y;
+                box_w = box_w * box_w * (float) anchor[a * 2];
+                box_h = box_h * box_h * (float) anchor[a * 2 + 1];
+                box_x -= (box_w / 2.0);
+                box_y -= (box_h / 2.0);
+
+                push_candidate(cand, box_x, box_y, box_w, box_h,
+                               f16_to_f32(in_ptr[5 + maxClassId]) * f16_to_f32(in_ptr[4]), maxClassId);
+                validCount++;
+            }
+        }
+    }
+    return validCount;
+}
+
+template<int NC>
+static int
+decode_f16_nhwc(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+                const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                const int *class_ids, int num_class_ids) {
+    int16_t conf_min = f16_threshold_key(threshold, false);
+    int16_t prob_min = f16_threshold_key(threshold, true);
+    if (conf_min > 0) {
+        return decode_f16_nhwc_rows<NC, true>(input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y,
+                                              task, cand, conf_min, prob_min, class_ids, num_class_ids);
+    }
+    return decode_f16_nhwc_rows<NC, false>(input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y,
+                                           task, cand, conf_min, prob_min, class_ids, num_class_ids);
+}
+
+// instantiated class counts: the single-class person model, 2 and COCO; a class selection
+// takes its own kernel whatever the count
+#define DISPATCH_CLASS_NUM(kernel, num_classes, class_ids, ...) \
+    if (class_ids != NULL) {                                  \
+        return kernel<NC_SELECTED>(__VA_ARGS__);              \
+    }                                                         \
+    switch (num_classes) {                                    \
+        case 1: return kernel<1>(__VA_ARGS__);                \
+        case 2: return kernel<2>(__VA_ARGS__);                \
+        case 80: return kernel<80>(__VA_ARGS__);              \
+        default: return kernel<0>(__VA_ARGS__);               \
+    }
+
+static int
+decode_task_i8(int8_t *input, const head_lut_t *lut, int grid_h, int grid_w, int num_classes,
+               const decode_task_t *task, candidate_arena_t *cand, float threshold,
+               const int *class_ids, int num_class_ids) {
+    DISPATCH_CLASS_NUM(decode_i8, num_classes, class_ids,
+                       input, lut, grid_h, grid_w, num_classes, task, cand, threshold,
+                       class_ids, num_class_ids);
+}
+
+static int
+decode_task_i8_nhwc(int8_t *input, const head_lut_t *lut, int grid_h, int grid_w, int num_classes,
+                    const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                    const int *class_ids, int num_class_ids) {
+    DISPATCH_CLASS_NUM(decode_i8_rv1106, num_classes, class_ids,
+                       input, lut, grid_h, grid_w, num_classes, task, cand, threshold,
+                       class_ids, num_class_ids);
+}
+
+static int
+decode_task_fp32(float *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+                 const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                 const int *class_ids, int num_class_ids) {
+    DISPATCH_CLASS_NUM(decode_fp32, num_classes, class_ids,
+                       input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y, task, cand, threshold,
+                       class_ids, num_class_ids);
+}
+
+static int
+decode_task_fp32_nhwc(float *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+                      const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                      const int *class_ids, int num_class_ids) {
+    DISPATCH_CLASS_NUM(decode_fp32_nhwc, num_classes, class_ids,
+                       input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y, task, cand, threshold,
+                       class_ids, num_class_ids);
+}
+
+static int
+decode_task_f16(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+                const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                const int *class_ids, int num_class_ids) {
+    DISPATCH_CLASS_NUM(decode_f16, num_classes, class_ids,
+                       input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y, task, cand, threshold,
+                       class_ids, num_class_ids);
+}
+
+static int
+decode_task_f16_nhwc(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride_x, int stride_y,
+                     const decode_task_t *task, candidate_arena_t *cand, float threshold,
+                     const int *class_ids, int num_class_ids) {
+    DISPATCH_CLASS_NUM(decode_f16_nhwc, num_classes, class_ids,
+                       input, anchor, grid_h, grid_w, num_classes, stride_x, stride_y, task, cand, threshold,
+                       class_ids, num_class_ids);
+}
+
+// a task covering all rows and anchors of a head
+static decode_task_t whole_head(int grid_h) {
+    decode_task_t task;
+    memset(&task, 0, sizeof(task));
+    task.anchor_end = 3;
+    task.row_end = grid_h;
+    return task;
+}
+
+int
+process_i8(int8_t *input, const head_lut_t *lut, int grid_h, int grid_w, int num_classes,
+           candidate_arena_t *cand, float threshold) {
+    decode_task_t task = whole_head(grid_h);
+    return decode_task_i8(input, lut, grid_h, grid_w, num_classes, &task, cand, threshold, NULL, 0);
+}
+
+int
+process_i8_rv1106(int8_t *input, const head_lut_t *lut, int grid_h, int grid_w, int num_classes,
+                  candidate_arena_t *cand, float threshold) {
+    decode_task_t task = whole_head(grid_h);
+    return decode_task_i8_nhwc(input, lut, grid_h, grid_w, num_classes, &task, cand, threshold, NULL, 0);
+}
+
+int
+process_fp32(float *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+             candidate_arena_t *cand, float threshold) {
+    decode_task_t task = whole_head(grid_h);
+    return decode_task_fp32(input, anchor, grid_h, grid_w, num_classes, stride, stride, &task, cand,
+                            threshold, NULL, 0);
+}
+
+int
+process_fp32_nhwc(float *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+                  candidate_arena_t *cand, float threshold) {
+    decode_task_t task = whole_head(grid_h);
+    return decode_task_fp32_nhwc(input, anchor, grid_h, grid_w, num_classes, stride, stride, &task, cand,
+                                 threshold, NULL, 0);
+}
+
+int
+process_f16(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+            candidate_arena_t *cand, float threshold) {
+    decode_task_t task = whole_head(grid_h);
+    return decode_task_f16(input, anchor, grid_h, grid_w, num_classes, stride, stride, &task, cand,
+                           threshold, NULL, 0);
+}
+
+int
+process_f16_nhwc(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+                 candidate_arena_t *cand, float threshold) {
+    decode_task_t task = whole_head(grid_h);
+    return decode_task_f16_nhwc(input, anchor, grid_h, grid_w, num_classes, stride, stride, &task, cand,
+                                threshold, NULL, 0);
+}
+
+// Anchor-free (YOLOv8) branches. A box side is a distribution over dfl_len bins, its
+// distance from the cell center in cells is the softmax expectation of the bins.
+
+// bin index of each lane
+static const float dfl_bins[DFL_LEN_MAX] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31};
+
+float dfl_expect_scalar(const float *x, int n) {
+    float m = x[0];
+    for (int k = 1; k < n; k++) {
+        m = x[k] > m ? x[k] : m;
+    }
+    float sum = 0.f;
+    float acc = 0.f;
+    for (int k = 0; k < n; k++) {
+        float e = expf(x[k] - m);
+        sum += e;
+        acc += e * (float) k;
+    }
+    return acc / sum;
+}
+
+// lanes of one vector and the few ops the expectation needs
+#if defined(POSTPROCESS_AVX2)
+#define DFL_LANES 8
+typedef __m256 dfl_vec;
+static inline dfl_vec dv_set(float v) { return _mm256_set1_ps(v); }
+static inline dfl_vec dv_load(const float *p) { return _mm256_loadu_ps(p); }
+static inline dfl_vec dv_add(dfl_vec a, dfl_vec b) { return _mm256_add_ps(a, b); }
+static inline dfl_vec dv_sub(dfl_vec a, dfl_vec b) { return _mm256_sub_ps(a, b); }
+static inline dfl_vec dv_mul(dfl_vec a, dfl_vec b) { return _mm256_mul_ps(a, b); }
+static inline dfl_vec dv_max(dfl_vec a, dfl_vec b) { return _mm256_max_ps(a, b); }
+// trunc(a), a within the int32 range
+static inline dfl_vec dv_trunc(dfl_vec a) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(a)); }
+// 2^n of an integral n in [-126, 127]
+static inline dfl_vec dv_pow2(dfl_vec n) {
+    __m256i e = _mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+}
+static inline float dv_hsum(dfl_vec a) {
+    __m128 v = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+static inline float dv_hmax(dfl_vec a) {
+    __m128 v = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+#elif defined(POSTPROCESS_SSE2)
+#define DFL_LANES 4
+typedef __m128 dfl_vec;
+static inline dfl_vec dv_set(float v) { return _mm_set1_ps(v); }
+static inline dfl_vec dv_load(const float *p) { return _mm_loadu_ps(p); }
+static inline dfl_vec dv_add(dfl_vec a, dfl_vec b) { return _mm_add_ps(a, b); }
+static inline dfl_vec dv_sub(dfl_vec a, dfl_vec b) { return _mm_sub_ps(a, b); }
+static inline dfl_vec dv_mul(dfl_vec a, dfl_vec b) { return _mm_mul_ps(a, b); }
+static inline dfl_vec dv_max(dfl_vec a, dfl_vec b) { return _mm_max_ps(a, b); }
+static inline dfl_vec dv_trunc(dfl_vec a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+static inline dfl_vec dv_pow2(dfl_vec n) {
+    __m128i e = _mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+}
+static inline float dv_hsum(dfl_vec v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+static inline float dv_hmax(dfl_vec v) {
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+#elif defined(POSTPROCESS_NEON)
+#define DFL_LANES 4
+typedef float32x4_t dfl_vec;
+static inline dfl_vec dv_set(float v) { return vdupq_n_f32(v); }
+static inline dfl_vec dv_load(const float *p) { return vld1q_f32(p); }
+static inline dfl_vec dv_add(dfl_vec a, dfl_vec b) { return vaddq_f32(a, b); }
+static inline dfl_vec dv_sub(dfl_vec a, dfl_vec b) { return vsubq_f32(a, b); }
+static inline dfl_vec dv_mul(dfl_vec a, dfl_vec b) { return vmulq_f32(a, b); }
+static inline dfl_vec dv_max(dfl_vec a, dfl_vec b) { return vmaxq_f32(a, b); }
+static inline dfl_vec dv_trunc(dfl_vec a) { return vcvtq_f32_s32(vcvtq_s32_f32(a)); }
+static inline dfl_vec dv_pow2(dfl_vec n) {
+    int32x4_t e = vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127));
+    return vreinterpretq_f32_s32(vshlq_n_s32(e, 23));
+}
+static inline float dv_hsum(dfl_vec v) {
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+static inline float dv_hmax(dfl_vec v) {
+    float32x2_t m = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmax_f32(m, m), 0);
+}
+#endif
+
+#if defined(DFL_LANES)
+// e^x of x <= 0, the exponent split off and the remainder in [-ln2/2, ln2/2] taken by the
+// cephes expf polynomial; within 2 ulp of expf, below -87 flushed to e^-87
+static inline dfl_vec dv_exp_neg(dfl_vec x) {
+    x = dv_max(x, dv_set(-87.f));
+    // n = round(x / ln2) of a negative x, with a truncating conversion
+    dfl_vec n = dv_sub(dv_set(0.f), dv_trunc(dv_sub(dv_set(0.5f), dv_mul(x, dv_set(1.44269504088896341f)))));
+    dfl_vec r = dv_sub(dv_sub(x, dv_mul(n, dv_set(0.693359375f))), dv_mul(n, dv_set(-2.12194440e-4f)));
+    dfl_vec p = dv_set(1.9875691500e-4f);
+    p = dv_add(dv_mul(p, r), dv_set(1.3981999507e-3f));
+    p = dv_add(dv_mul(p, r), dv_set(8.3334519073e-3f));
+    p = dv_add(dv_mul(p, r), dv_set(4.1665795894e-2f));
+    p = dv_add(dv_mul(p, r), dv_set(1.6666665459e-1f));
+    p = dv_add(dv_mul(p, r), dv_set(5.0000001201e-1f));
+    dfl_vec y = dv_add(dv_add(dv_mul(dv_mul(p, r), r), r), dv_set(1.f));
+    return dv_mul(y, dv_pow2(n));
+}
+#endif
+
+// the 16 bins of YOLOv8 are a few vectors wide
+float dfl_expect(const float *x, int n) {
+#if defined(DFL_LANES)
+    if (n % DFL_LANES == 0) {
+        dfl_vec m = dv_load(x);
+        for (int k = DFL_LANES; k < n; k += DFL_LANES) {
+            m = dv_max(m, dv_load(x + k));
+        }
+        dfl_vec vmax = dv_set(dv_hmax(m));
+        dfl_vec sum = dv_set(0.f);
+        dfl_vec acc = dv_set(0.f);
+        for (int k = 0; k < n; k += DFL_LANES) {
+            dfl_vec e = dv_exp_neg(dv_sub(dv_load(x + k), vmax));
+            sum = dv_add(sum, e);
+            acc = dv_add(acc, dv_mul(e, dv_load(dfl_bins + k)));
+        }
+        return dv_hsum(acc) / dv_hsum(sum);
+    }
+#endif
+    return dfl_expect_scalar(x, n);
+}
+
+// Element access of the anchor-free kernel: int8, fp16 bits or float32 values compared as
+// keys of the same order, the survivors converted to float
+template<typename T>
+struct dfl_elem;
+
+template<>
+struct dfl_elem<int8_t> {
+    typedef int8_t key_t;
+    static inline key_t key(int8_t v) { return v; }
+    static inline key_t lowest() { return -128; }
+    static inline float value(int8_t v, int32_t zp, float scale) { return deqnt_affine_to_f32(v, zp, scale); }
+    // smallest key of the values >= threshold, > threshold when strict; false when none passes
+    static bool floor(float threshold, bool strict, int32_t zp, float scale, key_t *floor) {
+        int q = qnt_f32_to_affine(threshold, zp, scale) + (strict ? 1 : 0);
+        *floor = (int8_t) (q > 127 ? 127 : q);
+        return q <= 127;
+    }
+};
+
+template<>
+struct dfl_elem<uint16_t> {
+    typedef int16_t key_t;
+    static inline key_t key(uint16_t h) { return f16_key(h); }
+    static inline key_t lowest() { return -0x7fff; }
+    static inline float value(uint16_t h, int32_t /* zp */, float /* scale */) { return f16_to_f32(h); }
+    static bool floor(float threshold, bool strict, int32_t /* zp */, float /* scale */, key_t *floor) {
+        *floor = f16_threshold_key(threshold, strict);
+        return *floor <= 0x7c00;
+    }
+};
+
+template<>
+struct dfl_elem<float> {
+    typedef float key_t;
+    static inline key_t key(float v) { return v; }
+    static inline key_t lowest() { return -INFINITY; }
+    static inline float value(float v, int32_t /* zp */, float /* scale */) { return v; }
+    static bool floor(float threshold, bool strict, int32_t /* zp */, float /* scale */, key_t *floor) {
+        *floor = strict ? nextafterf(threshold, INFINITY) : threshold;
+        return true;
+    }
+};
+
+// indices of the elements of plane[0, len) whose key is >= floor, returns the count
+static inline int scan_ge_keys(const int8_t *plane, int len, int8_t floor, int *indices) {
+    return scan_ge_i8(plane, len, floor, indices);
+}
+
+static inline int scan_ge_keys(const uint16_t *plane, int len, int16_t floor, int *indices) {
+    return scan_ge_f16(plane, len, floor, indices);
+}
+
+template<typename K>
+static inline int scan_ge_keys(const K *keys, int len, K floor, int *indices) {
+    int count = 0;
+    for (int i = 0; i < len; i++) {
+        if (keys[i] >= floor) {
+            indices[count++] = i;
+        }
+    }
+    return count;
+}
+
+// keys[k] = max(keys[k], key of plane[k]) over [0, len), the running best class of a block of cells
+static inline void max_keys(int8_t *keys, const int8_t *plane, int len) {
+    int k = 0;
+#if defined(POSTPROCESS_AVX2)
+    for (; k + 32 <= len; k += 32) {
+        __m256i m = _mm256_max_epi8(_mm256_loadu_si256((const __m256i *) (keys + k)),
+                                    _mm256_loadu_si256((const __m256i *) (plane + k)));
+        _mm256_storeu_si256((__m256i *) (keys + k), m);
+    }
+#endif
+#if defined(POSTPROCESS_SSE2)
+    // SSE2 only has an unsigned byte max, flip the sign bit to keep the order
+    const __m128i sign = _mm_set1_epi8((char) 0x80);
+    for (; k + 16 <= len; k += 16) {
+        __m128i m = _mm_max_epu8(_mm_xor_si128(_mm_loadu_si128((const __m128i *) (keys + k)), sign),
+                                 _mm_xor_si128(_mm_loadu_si128((const __m128i *) (plane + k)), sign));
+        _mm_storeu_si128((__m128i *) (keys + k), _mm_xor_si128(m, sign));
+    }
+#elif defined(POSTPROCESS_NEON)
+    for (; k + 16 <= len; k += 16) {
+        vst1q_s8(keys + k, vmaxq_s8(vld1q_s8(keys + k), vld1q_s8(plane + k)));
+    }
+#endif
+    for (; k < len; k++) {
+        keys[k] = plane[k] > keys[k] ? plane[k] : keys[k];
+    }
+}
+
+static inline void max_keys(int16_t *keys, const uint16_t *plane, int len) {
+    int k = 0;
+#if defined(POSTPROCESS_AVX2)
+    const __m256i abs32 = _mm256_set1_epi16(0x7fff);
+    for (; k + 16 <= len; k += 16) {
+        __m256i h = _mm256_loadu_si256((const __m256i *) (plane + k));
+        __m256i sign = _mm256_srai_epi16(h, 15);
+        __m256i key = _mm256_sub_epi16(_mm256_xor_si256(_mm256_and_si256(h, abs32), sign), sign);
+        _mm256_storeu_si256((__m256i *) (keys + k),
+                            _mm256_max_epi16(_mm256_loadu_si256((const __m256i *) (keys + k)), key));
+    }
+#endif
+#if defined(POSTPROCESS_SSE2)
+    const __m128i abs16 = _mm_set1_epi16(0x7fff);
+    for (; k + 8 <= len; k += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i *) (plane + k));
+        __m128i sign = _mm_srai_epi16(h, 15);
+        __m128i key = _mm_sub_epi16(_mm_xor_si128(_mm_and_si128(h, abs16), sign), sign);
+        _mm_storeu_si128((__m128i *) (keys + k), _mm_max_epi16(_mm_loadu_si128((const __m128i *) (keys + k)), key));
+    }
+#elif defined(POSTPROCESS_NEON)
+    const int16x8_t abs16 = vdupq_n_s16(0x7fff);
+    for (; k + 8 <= len; k += 8) {
+        int16x8_t h = vreinterpretq_s16_u16(vld1q_u16(plane + k));
+        int16x8_t sign = vshrq_n_s16(h, 15);
+        int16x8_t key = vsubq_s16(veorq_s16(vandq_s16(h, abs16), sign), sign);
+        vst1q_s16(keys + k, vmaxq_s16(vld1q_s16(keys + k), key));
+    }
+#endif
+    for (; k < len; k++) {
+        int16_t key = f16_key(plane[k]);
+        keys[k] = key > keys[k] ? key : keys[k];
+    }
+}
+
+static inline void max_keys(float *keys, const float *plane, int len) {
+    int k = 0;
+#if defined(POSTPROCESS_AVX2)
+    for (; k + 8 <= len; k += 8) {
+        _mm256_storeu_ps(keys + k, _mm256_max_ps(_mm256_loadu_ps(keys + k), _mm256_loadu_ps(plane + k)));
+    }
+#endif
+#if defined(POSTPROCESS_SSE2)
+    for (; k + 4 <= len; k += 4) {
+        _mm_storeu_ps(keys + k, _mm_max_ps(_mm_loadu_ps(keys + k), _mm_loadu_ps(plane + k)));
+    }
+#elif defined(POSTPROCESS_NEON)
+    for (; k + 4 <= len; k += 4) {
+        vst1q_f32(keys + k, vmaxq_f32(vld1q_f32(keys + k), vld1q_f32(plane + k)));
+    }
+#endif
+    for (; k < len; k++) {
+        keys[k] = plane[k] > keys[k] ? plane[k] : keys[k];
+    }
+}
+
+// Rows of one branch: cells whose best class score is above the threshold, found from the
+// score sum plane when the model exports it (the sum bounds every class score) or from the
+// running max over the class planes, then the argmax and box of each of them. Candidates
+// are appended in cell order.
+template<typename T>
+static int decode_dfl(const yolov5_decode *decode, void **outputs, const decode_task_t *task,
+                      candidate_arena_t *cand, float threshold, const int *class_ids, int num_class_ids) {
+    typedef typename dfl_elem<T>::key_t K;
+    const dfl_head_t *head = &decode->dfl[task->head];
+    const T *box = (const T *) outputs[head->box];
+    const T *score = (const T *) outputs[head->score];
+    const T *score_sum = head->score_sum >= 0 ? (const T *) outputs[head->score_sum] : NULL;
+    int grid_w = decode->grid_w[task->head];
+    int grid_len = decode->grid_h[task->head] * grid_w;
+    int dfl_len = decode->dfl_len;
+    int nc = class_ids != NULL ? num_class_ids : decode->num_classes;
+    K score_floor = dfl_elem<T>::lowest();
+    K sum_floor = dfl_elem<T>::lowest();
+    if (!dfl_elem<T>::floor(threshold, true, head->score_zp, head->score_scale, &score_floor) ||
+        (score_sum != NULL && !dfl_elem<T>::floor(threshold, false, head->sum_zp, head->sum_scale, &sum_floor))) {
+        return 0;
+    }
+    float stride_x = (float) head->stride_x;
+    float stride_y = (float) head->stride_y;
+    K block_max[SCAN_BLOCK];
+    int cells[SCAN_BLOCK];
+    float bins[4 * DFL_LEN_MAX];
+    int validCount = 0;
+    int cell_end = task->row_end * grid_w;
+
+    for (int base = task->row_begin * grid_w; base < cell_end; base += SCAN_BLOCK) {
+        int len = cell_end - base < SCAN_BLOCK ? cell_end - base : SCAN_BLOCK;
+        int n;
+        if (score_sum != NULL) {
+            n = scan_ge_keys(score_sum + base, len, sum_floor, cells);
+        } else {
+            for (int k = 0; k < len; k++) {
+                block_max[k] = dfl_elem<T>::lowest();
+            }
+            for (int c = 0; c < nc; c++) {
+                max_keys(block_max, score + (size_t) (class_ids != NULL ? class_ids[c] : c) * grid_len + base, len);
+            }
+            n = scan_ge_keys(block_max, len, score_floor, cells);
+        }
+        for (int s = 0; s < n; s++) {
+            int cell = base + cells[s];
+            // first best class of the cell
+            const T *p = score + cell;
+            int best = class_ids != NULL ? class_ids[0] : 0;
+            K best_key = dfl_elem<T>::key(p[(size_t) best * grid_len]);
+            for (int k = 1; k < nc; k++) {
+                int c = class_ids != NULL ? class_ids[k] : k;
+                K v = dfl_elem<T>::key(p[(size_t) c * grid_len]);
+                if (v > best_key) {
+                    best_key = v;
+                    best = c;
+                }
+            }
+            if (best_key < score_floor) {
+                continue;
+            }
+            // distances of the left, top, right and bottom sides from the cell center
+            for (int k = 0; k < 4 * dfl_len; k++) {
+                bins[k] = dfl_elem<T>::value(box[(size_t) k * grid_len + cell], head->box_zp, head->box_scale);
+            }
+            float left = dfl_expect(bins, dfl_len);
+            float top = dfl_expect(bins + dfl_len, dfl_len);
+            float right = dfl_expect(bins + 2 * dfl_len, dfl_len);
+            float bottom = dfl_expect(bins + 3 * dfl_len, dfl_len);
+            int i = cell / grid_w;
+            int j = cell - i * grid_w;
+            float x1 = (j + 0.5f - left) * stride_x;
+            float y1 = (i + 0.5f - top) * stride_y;
+            float x2 = (j + 0.5f + right) * stride_x;
+            float y2 = (i + 0.5f + bottom) * stride_y;
+            push_candidate(cand, x1, y1, x2 - x1, y2 - y1,
+                           dfl_elem<T>::value(p[(size_t) best * grid_len], head->score_zp, head->score_scale), best);
+            validCount++;
+        }
+    }
+    return validCount;
+}
+
+// head_decoder_t.decode_task of the anchor-free branches
+static int decode_dfl_task(const yolov5_decode *decode, void **outputs, const decode_task_t *task,
+                           candidate_arena_t *cand, float threshold, const int *class_ids, int num_class_ids) {
+    if (decode->output_type == RKNN_TENSOR_INT8) {
+        return decode_dfl<int8_t>(decode, outputs, task, cand, threshold, class_ids, num_class_ids);
+    } else if (decode->output_type == RKNN_TENSOR_FLOAT16) {
+        return decode_dfl<uint16_t>(decode, outputs, task, cand, threshold, class_ids, num_class_ids);
+    }
+    return decode_dfl<float>(decode, outputs, task, cand, threshold, class_ids, num_class_ids);
+}
+
+// head_decoder_t.decode_task of the anchor-based heads, the kernel of the layout and type
+static int decode_anchor_task(const yolov5_decode *decode, void **outputs, const decode_task_t *task,
+                              candidate_arena_t *cand, float threshold, const int *class_ids, int num_class_ids) {
+    int i = task->head;
+    int nhwc = decode->output_fmt == RKNN_TENSOR_NHWC;
+    if (decode->output_type == RKNN_TENSOR_INT8) {
+        return (nhwc ? decode_task_i8_nhwc : decode_task_i8)(
+                (int8_t *) outputs[i], &decode->lut[i], decode->grid_h[i], decode->grid_w[i],
+                decode->num_classes, task, cand, threshold, class_ids, num_class_ids);
+    } else if (decode->output_type == RKNN_TENSOR_FLOAT16) {
+        return (nhwc ? decode_task_f16_nhwc : decode_task_f16)(
+                (uint16_t *) outputs[i], (int *) decode->anchors[i], decode->grid_h[i], decode->grid_w[i],
+                decode->num_classes, decode->lut[i].stride_x, decode->lut[i].stride_y, task, cand, threshold,
+                class_ids, num_class_ids);
+    }
+    return (nhwc ? decode_task_fp32_nhwc : decode_task_fp32)(
+            (float *) outputs[i], (int *) decode->anchors[i], decode->grid_h[i], decode->grid_w[i],
+            decode->num_classes, decode->lut[i].stride_x, decode->lut[i].stride_y, task, cand, threshold,
+            class_ids, num_class_ids);
+}
+
+typedef struct {
+    rknn_app_context_t *app_ctx;
+    void **outputs;
+    float threshold;
+    const int *class_ids;       // ascending, NULL: every class
+    int num_class_ids;
+} decode_job_t;
+
+// pool task: decode one task of the frame into its slab
+static void decode_task_run(void *arg, int index) {
+    decode_job_t *job = (decode_job_t *) arg;
+    yolov5_decode *decode = job->app_ctx->decode;
+    decode_task_t *task = &decode->tasks[index];
+
+    // a view of the arena columns starting at the slab
+    candidate_arena_t slab = decode->cand;
+    slab.x1 += task->offset;
+    slab.y1 += task->offset;
+    slab.x2 += task->offset;
+    slab.y2 += task->offset;
+    slab.area += task->offset;
+    slab.score += task->offset;
+    slab.cls += task->offset;
+    slab.qscore += task->offset;
+    slab.count = 0;
+    task->count = decode->decoder->decode_task(decode, job->outputs, task, &slab, job->threshold,
+                                               job->class_ids, job->num_class_ids);
+}
+
+// close the gaps between the slabs, in task order the candidates are those of a sequential decode
+static int merge_slabs(yolov5_decode *decode) {
+    candidate_arena_t *cand = &decode->cand;
+    int count = 0;
+    for (int t = 0; t < decode->num_tasks; t++) {
+        const decode_task_t *task = &decode->tasks[t];
+        int from = task->offset;
+        int n = task->count;
+        if (n > 0 && from != count) {
+            memmove(cand->x1 + count, cand->x1 + from, n * sizeof(float));
+            memmove(cand->y1 + count, cand->y1 + from, n * sizeof(float));
+            memmove(cand->x2 + count, cand->x2 + from, n * sizeof(float));
+            memmove(cand->y2 + count, cand->y2 + from, n * sizeof(float));
+            memmove(cand->area + count, cand->area + from, n * sizeof(float));
+            memmove(cand->score + count, cand->score + from, n * sizeof(float));
+            memmove(cand->cls + count, cand->cls + from, n * sizeof(int));
+            memmove(cand->qscore + count, cand->qscore + from, n * sizeof(uint32_t));
+        }
+        count += n;
+    }
+    cand->count = count;
+    return count;
+}
+
+// the valid ids of class_ids into out, ascending and once each; returns their count
+static int sort_class_ids(yolov5_decode *decode, const int *class_ids, int num_class_ids, int *out) {
+    memset(decode->class_mask, 0, decode->num_classes);
+    for (int k = 0; k < num_class_ids; k++) {
+        if (class_ids[k] >= 0 && class_ids[k] < decode->num_classes) {
+            decode->class_mask[class_ids[k]] = 1;
+        }
+    }
+    int count = 0;
+    for (int c = 0; c < decode->num_classes; c++) {
+        if (decode->class_mask[c]) {
+            out[count++] = c;
+        }
+    }
+    return count;
+}
+
+// classes decoded by a call: its allowlist, else the model's; NULL with every class
+static const int *select_classes(yolov5_decode *decode, const detect_options_t *opts, int *num_class_ids) {
+    const int *class_ids = decode->model_classes;
+    *num_class_ids = decode->num_model_classes;
+    if (opts->num_allowed_classes > 0 && opts->class_allowlist == NULL) {
+        LOGE("detect options: %d allowed classes without a list, decode the model classes\n",
+             opts->num_allowed_classes);
+    } else if (opts->num_allowed_classes > 0) {
+        class_ids = decode->call_classes;
+        *num_class_ids = sort_class_ids(decode, opts->class_allowlist, opts->num_allowed_classes,
+                                        decode->call_classes);
+    }
+    return *num_class_ids > 0 && *num_class_ids < decode->num_classes ? class_ids : NULL;
+}
+
+void default_detect_options(detect_options_t *opts) {
+    memset(opts, 0, sizeof(detect_options_t));
+    opts->conf_threshold = BOX_THRESH;
+    opts->nms_threshold = NMS_THRESH;
+    opts->max_detections = OBJ_NUMB_MAX_SIZE;
+    opts->pre_nms_topk = PRE_NMS_TOPK;
+}
+
 int post_process(rknn_app_context_t *app_ctx, void **outputs, letterbox_t *letter_box,
-                 float conf_threshold, float nms_threshold, object_detect_result_list *od_results) {
-    std::vector<float> filterBoxes;
-    std::vector<float> objProbs;
-    std::vector<int> classId;
+                 const detect_options_t *opts, object_detect_result_list *od_results) {
     int validCount = 0;
-    int stride = 0;
-    int grid_h = 0;
-    int grid_w = 0;
     int model_in_w = app_ctx->model_width;
     int model_in_h = app_ctx->model_height;
 
     memset(od_results, 0, sizeof(object_detect_result_list));
-
-    for (int i = 0; i < 3; i++) {
-        grid_h = app_ctx->output_attrs[i].dims[2];
-        grid_w = app_ctx->output_attrs[i].dims[3];
-        stride = model_in_h / grid_h;
-        if (app_ctx->is_quant) {
-            validCount += process_i8((int8_t *) outputs[i], (int *) anchor[i], grid_h, grid_w,
-                                     model_in_h, model_in_w, stride, filterBoxes, objProbs,
-                                     classId, conf_threshold, app_ctx->output_attrs[i].zp,
-                                     app_ctx->output_attrs[i].scale);
-        } else {
-            validCount += process_fp32((float *) outputs[i], (int *) anchor[i], grid_h, grid_w,
-                                       model_in_h, model_in_w, stride, filterBoxes, objProbs,
-                                       classId, conf_threshold);
-        }
+    if (app_ctx->decode == NULL) {
+        LOGE("decode state is not built, call init_yolov5_decode\n");
+        return -1;
     }
+    detect_options_t default_opts;
+    if (opts == NULL) {
+        default_detect_options(&default_opts);
+        opts = &default_opts;
+    }
+    int max_detections = opts->max_detections > 0 && opts->max_detections < OBJ_NUMB_MAX_SIZE
+                         ? opts->max_detections : OBJ_NUMB_MAX_SIZE;
+    yolov5_decode *decode = app_ctx->decode;
+    candidate_arena_t *cand = &decode->cand;
+    // only the allowed class channels are read, a box takes its best allowed class
+    int num_class_ids = 0;
+    const int *class_ids = select_classes(decode, opts, &num_class_ids);
+    if (opts->num_allowed_classes > 0 && opts->class_allowlist != NULL && num_class_ids == 0) {
+        return 0;
+    }
+    // the heads fan out over the pool in row bands, each into its own slab
+    decode_job_t job = {app_ctx, outputs, opts->conf_threshold, class_ids, num_class_ids};
+    int decode_classes = class_ids != NULL ? num_class_ids : decode->num_classes;
+    int parallel = !app_ctx->is_quant || decode_classes >= DECODE_PARALLEL_MIN_CLASSES;
+    thread_pool_run(parallel ? app_ctx->pool : NULL, decode->num_tasks, decode_task_run, &job);
+    validCount = merge_slabs(decode);
 
     // no object detect
     if (validCount <= 0) {
         return 0;
     }
-    std::vector<int> indexArray;
-    for (int i = 0; i < validCount; ++i) {
-        indexArray.push_back(i);
+    // the best pre_nms_topk candidates, best first; quantized scores take the radix sort
+    if (app_ctx->is_quant) {
+        validCount = radix_topk_indices(cand->qscore, validCount, opts->pre_nms_topk, cand->order,
+                                        cand->scratch);
+    } else {
+        validCount = topk_indices(cand->score, validCount, opts->pre_nms_topk, cand->order);
     }
-    quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
 
-    std::set<int> class_set(std::begin(classId), std::end(classId));
+    nms_boxes_t nms_boxes;
+    nms_boxes.count = validCount;
+    nms_boxes.x1 = cand->x1;
+    nms_boxes.y1 = cand->y1;
+    nms_boxes.x2 = cand->x2;
+    nms_boxes.y2 = cand->y2;
+    nms_boxes.area = cand->area;
+    nms_boxes.cls = cand->cls;
+    nms_boxes.order = cand->order;
 
-    for (auto c: class_set) {
-        nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
-    }
+    // NMS stops once max_detections boxes are kept
+    int keep[OBJ_NUMB_MAX_SIZE];
+    int keepCount = decode->nms_engine == NMS_ENGINE_GRID
+                    ? nms_grid(&nms_boxes, opts->nms_threshold, max_detections, model_in_w, model_in_h, keep)
+                    : nms(&nms_boxes, opts->nms_threshold, max_detections, keep);
 
     int last_count = 0;
     od_results->count = 0;
 
     /* box valid detect target */
-    for (int i = 0; i < validCount; ++i) {
-        if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE) {
-            continue;
-        }
-        int n = indexArray[i];
+    for (int k = 0; k < keepCount; ++k) {
+        int n = keep[k];
 
-        float x1 = filterBoxes[n * 4 + 0] - letter_box->x_pad;
-        float y1 = filterBoxes[n * 4 + 1] - letter_box->y_pad;
-        float x2 = x1 + filterBoxes[n * 4 + 2];
-        float y2 = y1 + filterBoxes[n * 4 + 3];
-        int id = classId[n];
-        float obj_conf = objProbs[i];
+        float x1 = cand->x1[n] - letter_box->x_pad;
+        float y1 = cand->y1[n] - letter_box->y_pad;
+        float x2 = cand->x2[n] - letter_box->x_pad;
+        float y2 = cand->y2[n] - letter_box->y_pad;
+        int id = cand->cls[n];
+        float obj_conf = cand->score[n];
 
         od_results->results[last_count].box.left = (int) (clamp(x1, 0, model_in_w) /
                                                           letter_box->scale);
@@ -435,6 +1816,379 @@ int post_process(rknn_app_context_t *app_ctx, void **outputs, letterbox_t *lette
     return 0;
 }
 
+void build_head_lut(head_lut_t *lut, const int *anchor, int stride_x, int stride_y, int32_t zp, float scale) {
+    lut->zp = zp;
+    lut->scale = scale;
+    lut->stride_x = stride_x;
+    lut->stride_y = stride_y;
+    // same float steps as the arithmetic the tables replace
+    for (int v = -128; v < 128; v++) {
+        float deq = deqnt_affine_to_f32((int8_t) v, zp, scale);
+        float wh = deq * 2.0;
+        lut->xy[v + 128] = deq * 2.0 - 0.5;
+        lut->score[v + 128] = deq;
+        for (int a = 0; a < 3; a++) {
+            lut->wh[a][0][v + 128] = wh * wh * (float) anchor[a * 2];
+            lut->wh[a][1][v + 128] = wh * wh * (float) anchor[a * 2 + 1];
+        }
+    }
+}
+
+// one aligned block for every column, sized for a candidate per anchor of the 3 heads
+static int init_candidate_arena(candidate_arena_t *cand, const yolov5_decode *decode) {
+    int capacity = 0;
+    for (int i = 0; i < 3; i++) {
+        capacity += decode->decoder->anchors_per_cell * decode->grid_h[i] * decode->grid_w[i];
+    }
+    // 8 columns, the order and 3 columns of sort scratch, each column a multiple of 64 bytes
+    size_t column = ((size_t) capacity + 15) & ~(size_t) 15;
+    void *block = NULL;
+    if (capacity <= 0 || posix_memalign(&block, 64, 12 * column * sizeof(float)) != 0) {
+        LOGE("alloc candidate arena of %d fail!\n", capacity);
+        return -1;
+    }
+    float *col = (float *) block;
+    cand->block = block;
+    cand->capacity = capacity;
+    cand->count = 0;
+    cand->x1 = col;
+    cand->y1 = col + column;
+    cand->x2 = col + 2 * column;
+    cand->y2 = col + 3 * column;
+    cand->area = col + 4 * column;
+    cand->score = col + 5 * column;
+    cand->cls = (int *) (col + 6 * column);
+    cand->qscore = (uint32_t *) (col + 7 * column);
+    cand->order = (int *) (col + 8 * column);
+    cand->scratch = (uint32_t *) (col + 9 * column);
+    return 0;
+}
+
+// Split the heads into bands of about DECODE_TASK_ANCHORS anchors: every anchor plane of
+// an NCHW head, the cells of an NHWC head with all their anchors. Either way the task order is
+// the order a whole-head decode appends in, and the split depends on the model only, so the
+// candidate order is the same for any pool size.
+static int init_decode_tasks(yolov5_decode *decode) {
+    int num_tasks = 0;
+    // anchors of a cell decoded by one task
+    int anchors = decode->decoder->anchors_per_cell;
+    int anchor_step = decode->output_fmt == RKNN_TENSOR_NHWC ? anchors : 1;
+    for (int pass = 0; pass < 2; pass++) {
+        int t = 0;
+        int offset = 0;
+        for (int i = 0; i < 3; i++) {
+            int grid_h = decode->grid_h[i];
+            int grid_w = decode->grid_w[i];
+            int rows = grid_w > 0 ? DECODE_TASK_ANCHORS / (grid_w * anchor_step) : grid_h;
+            rows = rows < 1 ? 1 : rows;
+            for (int a = 0; a < anchors; a += anchor_step) {
+                for (int row = 0; row < grid_h; row += rows) {
+                    if (pass == 1) {
+                        decode_task_t *task = &decode->tasks[t];
+                        task->head = i;
+                        task->anchor_begin = a;
+                        task->anchor_end = a + anchor_step;
+                        task->row_begin = row;
+                        task->row_end = row + rows < grid_h ? row + rows : grid_h;
+                        task->offset = offset;
+                        task->count = 0;
+                        offset += (task->row_end - row) * grid_w * anchor_step;
+                    }
+                    t++;
+                }
+            }
+        }
+        if (pass == 0) {
+            decode->tasks = (decode_task_t *) calloc(t > 0 ? t : 1, sizeof(decode_task_t));
+            if (decode->tasks == NULL) {
+                return -1;
+            }
+            num_tasks = t;
+        }
+    }
+    decode->num_tasks = num_tasks;
+    return 0;
+}
+
+static inline int head_channels(const rknn_tensor_attr *attr) {
+    return attr->fmt == RKNN_TENSOR_NHWC ? attr->dims[3] : attr->dims[1];
+}
+
+static inline int head_grid_h(const rknn_tensor_attr *attr) {
+    return attr->fmt == RKNN_TENSOR_NHWC ? attr->dims[1] : attr->dims[2];
+}
+
+static inline int head_grid_w(const rknn_tensor_attr *attr) {
+    return attr->fmt == RKNN_TENSOR_NHWC ? attr->dims[2] : attr->dims[3];
+}
+
+// Model pixels per cell along one axis: the power of two whose rounded up division gives the
+// grid, so the 23 rows of the stride 16 head of a 360 high model are not read as stride 15;
+// model size / grid when none does
+static int head_stride(int model_size, int grid) {
+    if (grid <= 0) {
+        return 0;
+    }
+    for (int s = 1; s <= 128; s *= 2) {
+        if ((model_size + s - 1) / s == grid) {
+            return s;
+        }
+    }
+    return model_size / grid;
+}
+
+// strides of head i, the config ones when given
+static void head_strides(const rknn_app_context_t *app_ctx, const yolov5_decode *decode, int i,
+                         int *stride_x, int *stride_y) {
+    const decode_config_t *config = yolov5_decode_config(app_ctx);
+    if (config->strides[i] > 0) {
+        *stride_x = config->strides[i];
+        *stride_y = config->strides[i];
+        return;
+    }
+    *stride_x = head_stride(app_ctx->model_width, decode->grid_w[i]);
+    *stride_y = head_stride(app_ctx->model_height, decode->grid_h[i]);
+}
+
+// a class count in the decode config must be the one of the outputs
+static int check_config_classes(const rknn_app_context_t *app_ctx, int num_classes) {
+    const decode_config_t *config = yolov5_decode_config(app_ctx);
+    if (config->num_classes > 0 && config->num_classes != num_classes) {
+        LOGE("decode config: %d classes, the outputs have %d\n", config->num_classes, num_classes);
+        return -1;
+    }
+    return 0;
+}
+
+// the fallback family, init_anchor_heads reports what does not fit
+static int match_anchor_heads(const rknn_input_output_num *io_num, const rknn_tensor_attr * /* output_attrs */) {
+    return io_num->n_output >= 3;
+}
+
+static int init_anchor_heads(const rknn_app_context_t *app_ctx, yolov5_decode *decode) {
+    // every head carries 3 anchors of (x, y, w, h, obj, classes...), all in one layout
+    int num_classes = 0;
+    for (int i = 0; i < 3; i++) {
+        rknn_tensor_attr *attr = &app_ctx->output_attrs[i];
+        if (attr->fmt != RKNN_TENSOR_NCHW && attr->fmt != RKNN_TENSOR_NHWC) {
+            LOGE("output %d: %s is not decoded, expect NCHW or NHWC\n", i, get_format_string(attr->fmt));
+            return -1;
+        }
+        if (attr->fmt != app_ctx->output_attrs[0].fmt) {
+            LOGE("output %d: %s, output 0 is %s\n", i, get_format_string(attr->fmt),
+                 get_format_string(app_ctx->output_attrs[0].fmt));
+            return -1;
+        }
+        if (attr->type != app_ctx->output_attrs[0].type) {
+            LOGE("output %d: %s, output 0 is %s\n", i, get_type_string(attr->type),
+                 get_type_string(app_ctx->output_attrs[0].type));
+            return -1;
+        }
+        int channels = head_channels(attr);
+        if (attr->n_dims != 4 || channels % 3 != 0 || channels / 3 <= 5) {
+            LOGE("output %d: %d channels is not 3 * (5 + classes)\n", i, channels);
+            return -1;
+        }
+        if (i > 0 && channels / 3 - 5 != num_classes) {
+            LOGE("output %d: %d classes, output 0 has %d\n", i, channels / 3 - 5, num_classes);
+            return -1;
+        }
+        num_classes = channels / 3 - 5;
+    }
+    if (check_config_classes(app_ctx, num_classes) != 0) {
+        return -1;
+    }
+    decode->num_classes = num_classes;
+    decode->prop_box_size = 5 + num_classes;
+    decode->output_fmt = app_ctx->output_attrs[0].fmt;
+    decode->output_type = yolov5_output_type(app_ctx, 0);
+    memcpy(decode->anchors, yolov5_decode_config(app_ctx)->anchors, sizeof(decode->anchors));
+    for (int i = 0; i < 3; i++) {
+        rknn_tensor_attr *attr = &app_ctx->output_attrs[i];
+        decode->grid_h[i] = head_grid_h(attr);
+        decode->grid_w[i] = head_grid_w(attr);
+        int stride_x, stride_y;
+        head_strides(app_ctx, decode, i, &stride_x, &stride_y);
+        build_head_lut(&decode->lut[i], decode->anchors[i], stride_x, stride_y, attr->zp, attr->scale);
+    }
+    return 0;
+}
+
+// 3 branches of 2 or 3 outputs: 4 * dfl_len box channels, the class scores and optionally
+// their sum, all on the grid of the branch
+static int match_dfl_heads(const rknn_input_output_num *io_num, const rknn_tensor_attr *output_attrs) {
+    if (io_num->n_output != 6 && io_num->n_output != 9) {
+        return 0;
+    }
+    int per_branch = io_num->n_output / 3;
+    for (int b = 0; b < 3; b++) {
+        const rknn_tensor_attr *box = &output_attrs[b * per_branch];
+        if (box->n_dims != 4 || head_channels(box) % 4 != 0) {
+            return 0;
+        }
+        for (int k = 1; k < per_branch; k++) {
+            const rknn_tensor_attr *attr = &output_attrs[b * per_branch + k];
+            if (attr->n_dims != 4 || head_grid_h(attr) != head_grid_h(box) || head_grid_w(attr) != head_grid_w(box)) {
+                return 0;
+            }
+        }
+        if (per_branch == 3 && head_channels(&output_attrs[b * per_branch + 2]) != 1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int init_dfl_heads(const rknn_app_context_t *app_ctx, yolov5_decode *decode) {
+    int per_branch = app_ctx->io_num.n_output / 3;
+    const rknn_tensor_attr *attrs = app_ctx->output_attrs;
+    for (uint32_t i = 0; i < app_ctx->io_num.n_output; i++) {
+        if (attrs[i].fmt != RKNN_TENSOR_NCHW) {
+            LOGE("output %d: %s is not decoded, anchor-free heads are read NCHW\n", i,
+                 get_format_string(attrs[i].fmt));
+            return -1;
+        }
+        if (yolov5_output_type(app_ctx, i) != yolov5_output_type(app_ctx, 0)) {
+            LOGE("output %d: %s, output 0 is %s\n", i, get_type_string(attrs[i].type),
+                 get_type_string(attrs[0].type));
+            return -1;
+        }
+    }
+    decode->dfl_len = head_channels(&attrs[0]) / 4;
+    decode->num_classes = head_channels(&attrs[1]);
+    if (decode->dfl_len <= 0 || decode->dfl_len > DFL_LEN_MAX || decode->num_classes <= 0) {
+        LOGE("%d box bins per side and %d classes are not decoded\n", decode->dfl_len, decode->num_classes);
+        return -1;
+    }
+    if (check_config_classes(app_ctx, decode->num_classes) != 0) {
+        return -1;
+    }
+    decode->output_fmt = RKNN_TENSOR_NCHW;
+    decode->output_type = yolov5_output_type(app_ctx, 0);
+    for (int b = 0; b < 3; b++) {
+        dfl_head_t *head = &decode->dfl[b];
+        head->box = b * per_branch;
+        head->score = b * per_branch + 1;
+        head->score_sum = per_branch == 3 ? b * per_branch + 2 : -1;
+        const rknn_tensor_attr *box = &attrs[head->box];
+        const rknn_tensor_attr *score = &attrs[head->score];
+        if (head_channels(box) != 4 * decode->dfl_len || head_channels(score) != decode->num_classes) {
+            LOGE("branch %d: %d box and %d score channels, branch 0 has %d and %d\n", b, head_channels(box),
+                 head_channels(score), 4 * decode->dfl_len, decode->num_classes);
+            return -1;
+        }
+        decode->grid_h[b] = head_grid_h(box);
+        decode->grid_w[b] = head_grid_w(box);
+        head_strides(app_ctx, decode, b, &head->stride_x, &head->stride_y);
+        head->box_zp = box->zp;
+        head->box_scale = box->scale;
+        head->score_zp = score->zp;
+        head->score_scale = score->scale;
+        head->sum_zp = head->score_sum >= 0 ? attrs[head->score_sum].zp : 0;
+        head->sum_scale = head->score_sum >= 0 ? attrs[head->score_sum].scale : 1.f;
+    }
+    return 0;
+}
+
+static const head_decoder_t yolov8_heads = {
+        "yolov8", 1, 0, match_dfl_heads, init_dfl_heads, decode_dfl_task,
+};
+
+static const head_decoder_t yolov5_heads = {
+        "yolov5", 3, 1, match_anchor_heads, init_anchor_heads, decode_anchor_task,
+};
+
+// in match order, the fallback last
+static const head_decoder_t *const head_decoders[] = {&yolov8_heads, &yolov5_heads};
+
+const head_decoder_t *find_head_decoder(const rknn_input_output_num *io_num, const rknn_tensor_attr *output_attrs) {
+    for (size_t i = 0; i < sizeof(head_decoders) / sizeof(head_decoders[0]); i++) {
+        if (head_decoders[i]->match(io_num, output_attrs)) {
+            return head_decoders[i];
+        }
+    }
+    return NULL;
+}
+
+int init_yolov5_decode(rknn_app_context_t *app_ctx) {
+    release_yolov5_decode(app_ctx);
+    const head_decoder_t *decoder = find_head_decoder(&app_ctx->io_num, app_ctx->output_attrs);
+    if (decoder == NULL) {
+        LOGE("expect 3 YOLOv5 heads or 6/9 YOLOv8 outputs, got %d outputs\n", app_ctx->io_num.n_output);
+        return -1;
+    }
+    yolov5_decode *decode = (yolov5_decode *) calloc(1, sizeof(yolov5_decode));
+    if (decode == NULL) {
+        return -1;
+    }
+    decode->decoder = decoder;
+    if (decoder->init(app_ctx, decode) != 0) {
+        free(decode);
+        return -1;
+    }
+    int num_classes = decode->num_classes;
+    decode->class_mask = (uint8_t *) malloc(num_classes);
+    decode->model_classes = (int *) malloc(num_classes * sizeof(int));
+    decode->call_classes = (int *) malloc(num_classes * sizeof(int));
+    if (decode->class_mask == NULL || decode->model_classes == NULL || decode->call_classes == NULL ||
+        init_candidate_arena(&decode->cand, decode) != 0) {
+        free(decode->call_classes);
+        free(decode->model_classes);
+        free(decode->class_mask);
+        free(decode);
+        return -1;
+    }
+    app_ctx->decode = decode;
+    if (init_decode_tasks(decode) != 0) {
+        release_yolov5_decode(app_ctx);
+        return -1;
+    }
+    LOGI("decode: %s, %d classes, %s %s heads, %d tasks\n", decoder->name, num_classes,
+         get_type_string((rknn_tensor_type) decode->output_type),
+         decode->output_fmt == RKNN_TENSOR_NHWC ? "NHWC" : "NCHW", decode->num_tasks);
+    return 0;
+}
+
+int set_yolov5_decode_classes(rknn_app_context_t *app_ctx, const int *class_ids, int num_class_ids) {
+    yolov5_decode *decode = app_ctx->decode;
+    if (decode == NULL) {
+        LOGE("decode state is not built, call init_yolov5_decode\n");
+        return -1;
+    }
+    if (class_ids == NULL || num_class_ids <= 0) {
+        decode->num_model_classes = 0;
+        return 0;
+    }
+    int count = sort_class_ids(decode, class_ids, num_class_ids, decode->call_classes);
+    if (count == 0) {
+        LOGE("none of the %d class ids is below %d\n", num_class_ids, decode->num_classes);
+        return -1;
+    }
+    memcpy(decode->model_classes, decode->call_classes, count * sizeof(int));
+    decode->num_model_classes = count;
+    LOGI("decode: %d of %d classes\n", count, decode->num_classes);
+    return 0;
+}
+
+rknn_tensor_type yolov5_output_type(const rknn_app_context_t *app_ctx, int i) {
+    if (app_ctx->is_quant) {
+        return RKNN_TENSOR_INT8;
+    }
+    return app_ctx->output_attrs[i].type == RKNN_TENSOR_FLOAT16 ? RKNN_TENSOR_FLOAT16 : RKNN_TENSOR_FLOAT32;
+}
+
+void release_yolov5_decode(rknn_app_context_t *app_ctx) {
+    if (app_ctx->decode != NULL) {
+        free(app_ctx->decode->tasks);
+        free(app_ctx->decode->class_mask);
+        free(app_ctx->decode->model_classes);
+        free(app_ctx->decode->call_classes);
+        free(app_ctx->decode->cand.block);
+        free(app_ctx->decode);
+        app_ctx->decode = NULL;
+    }
+}
+
 int init_post_process(const char *labelListPath) {
     int ret = 0;
     ret = loadLabelName(labelListPath, labels);
@@ -447,7 +2201,7 @@ int init_post_process(const char *labelListPath) {
 
 char *coco_cls_to_name(int cls_id) {
 
-    if (cls_id >= OBJ_CLASS_NUM) {
+    if (cls_id < 0 || cls_id >= OBJ_CLASS_MAX) {
         return "null";
     }
 
@@ -459,7 +2213,7 @@ char *coco_cls_to_name(int cls_id) {
 }
 
 void deInit_post_process() {
-    for (int i = 0; i < OBJ_CLASS_NUM; i++) {
+    for (int i = 0; i < OBJ_CLASS_MAX; i++) {
         if (labels[i] != nullptr) {
             free(labels[i]);
             labels[i] = nullptr;
@@ -9,14 +9,158 @@
 
 #define OBJ_NAME_MAX_SIZE 64
 #define OBJ_NUMB_MAX_SIZE 128
-//#define OBJ_CLASS_NUM 80
-#define OBJ_CLASS_NUM 1
+// labels kept by init_post_process, the class count itself comes from the model outputs
+#define OBJ_CLASS_MAX 1000
 #define NMS_THRESH 0.45
 #define BOX_THRESH 0.25
-#define PROP_BOX_SIZE (5 + OBJ_CLASS_NUM)
+// best scoring candidates sorted and handed to NMS
+#define PRE_NMS_TOPK 1024
+// anchors decoded by one pool task, the stride-8 head of a 640 model splits into 12 tasks
+#define DECODE_TASK_ANCHORS 1600
+// int8 models with fewer classes decode on the calling thread, faster than waking the workers
+#define DECODE_PARALLEL_MIN_CLASSES 8
+// most distribution bins per box side of an anchor-free head, YOLOv8 exports 16
+#define DFL_LEN_MAX 32
 
 // class rknn_app_context_t;
 
+/**
+ * @brief Decode tables of one int8 output head, indexed by the raw value + 128
+ *
+ */
+typedef struct {
+    int32_t zp;
+    float scale;
+    int stride_x;           // model input pixels per grid cell, horizontally
+    int stride_y;           // and vertically
+    float xy[256];          // deq(v) * 2 - 0.5, box center offset in grid cells
+    float wh[3][2][256];    // (deq(v) * 2)^2 * anchor, box w/h of each anchor
+    float score[256];       // deq(v)
+} head_lut_t;
+
+/**
+ * @brief Outputs of one anchor-free (YOLOv8) branch, its stride and quantization
+ *
+ */
+typedef struct {
+    int box;                // output of the 4 * dfl_len box side distributions (left, top, right, bottom)
+    int score;              // output of the num_classes class scores
+    int score_sum;          // output of the clipped class score sum, -1 when not exported
+    int stride_x;
+    int stride_y;
+    int32_t box_zp;
+    float box_scale;
+    int32_t score_zp;
+    float score_scale;
+    int32_t sum_zp;
+    float sum_scale;
+} dfl_head_t;
+
+/**
+ * @brief Candidate boxes of a frame, one column per field, sized once for a box per anchor
+ *        of every head and reset by each post_process
+ *
+ */
+typedef struct {
+    void *block;            // every column, 64-byte aligned
+    int capacity;
+    int count;
+    float *x1;
+    float *y1;
+    float *x2;
+    float *y2;
+    float *area;            // (x2 - x1 + 1) * (y2 - y1 + 1)
+    float *score;
+    int *cls;
+    uint32_t *qscore;       // score mapped to an unsigned key of the same order, radix sorted
+    int *order;             // candidates handed to NMS, best first
+    uint32_t *scratch;      // 3 * capacity words of sort workspace
+} candidate_arena_t;
+
+/**
+ * @brief Rows [row_begin, row_end) of anchors [anchor_begin, anchor_end) of one head,
+ *        decoded by one pool task into its own slab of the candidate arena
+ *
+ */
+typedef struct {
+    int head;
+    int anchor_begin;
+    int anchor_end;
+    int row_begin;
+    int row_end;
+    int offset;             // first arena slot of the slab, a slot per anchor of the task
+    int count;              // candidates of the last frame
+} decode_task_t;
+
+/**
+ * @brief NMS implementation used by post_process
+ *
+ */
+typedef enum {
+    NMS_ENGINE_EXHAUSTIVE = 0,  // every candidate against every kept box, SIMD
+    NMS_ENGINE_GRID,            // kept boxes bucketed in a uniform grid over the model input
+} nms_engine_t;
+
+/**
+ * @brief Options of one post_process call, default_detect_options fills in the defaults
+ *
+ */
+typedef struct {
+    float conf_threshold;           // objectness and class score floor, BOX_THRESH
+    float nms_threshold;            // IoU suppressing the lower scored box of a class, NMS_THRESH
+    int max_detections;             // results kept, <= 0 or above OBJ_NUMB_MAX_SIZE: OBJ_NUMB_MAX_SIZE
+    int pre_nms_topk;               // best candidates handed to NMS, PRE_NMS_TOPK, <= 0: all
+    const int *class_allowlist;     // class ids decoded, a box takes its best allowed class
+    int num_allowed_classes;        // entries of class_allowlist, 0 or no list: set_yolov5_decode_classes
+} detect_options_t;
+
+struct yolov5_decode;
+
+/**
+ * @brief Decoder of one head family; init_yolov5_decode takes the first decoder whose
+ *        signature matches the model outputs. The candidates a decoder appends go through
+ *        the same top-K, NMS and result mapping whatever the family.
+ *
+ */
+typedef struct head_decoder {
+    const char *name;
+    int anchors_per_cell;   // candidate slots of a grid cell
+    int nhwc;               // NHWC heads are decoded too, else only NCHW ones
+    // 1 when the output attrs have the signature of the family
+    int (*match)(const rknn_input_output_num *io_num, const rknn_tensor_attr *output_attrs);
+    // class count, grids and tables of decode from the output attrs; 0: success, -1: error
+    int (*init)(const rknn_app_context_t *app_ctx, struct yolov5_decode *decode);
+    // decode one task of a frame into cand, returns the candidates appended
+    int (*decode_task)(const struct yolov5_decode *decode, void **outputs, const decode_task_t *task,
+                       candidate_arena_t *cand, float threshold, const int *class_ids, int num_class_ids);
+} head_decoder_t;
+
+/**
+ * @brief Decode state of a model, built once from its output attrs
+ *
+ */
+struct yolov5_decode {
+    const head_decoder_t *decoder;  // head family of the model
+    int nms_engine;         // nms_engine_t, NMS_ENGINE_EXHAUSTIVE by default
+    int num_classes;        // from the output channels
+    int prop_box_size;      // anchor-based heads: 5 + num_classes
+    int dfl_len;            // anchor-free heads: distribution bins per box side
+    int output_fmt;         // rknn_tensor_format of the heads, NCHW or NHWC, selects the decoders
+    int output_type;        // rknn_tensor_type of the heads handed to post_process, yolov5_output_type
+    int grid_h[3];
+    int grid_w[3];
+    head_lut_t lut[3];      // anchor-based heads
+    dfl_head_t dfl[3];      // anchor-free heads
+    int anchors[3][6];      // anchor-based heads: w/h of the 3 anchors of each head, from the decode config
+    candidate_arena_t cand;
+    int num_tasks;          // in candidate order: head, then anchor, then rows
+    decode_task_t *tasks;
+    uint8_t *class_mask;    // num_classes flags, scratch of the class selections
+    int num_model_classes;  // classes decoded when a call brings no allowlist, 0: every class
+    int *model_classes;     // ascending ids, set_yolov5_decode_classes
+    int *call_classes;      // ascending ids of the allowlist of the current call
+};
+
 typedef struct {
     image_rect_t box;
     float prop;
@@ -31,12 +175,88 @@ typedef struct {
 
 int init_post_process(const char *labelListPath);
 
+/**
+ * @brief Build the decode tables of one int8 head
+ *
+ * @param lut [out] Tables
+ * @param anchor [in] w/h of the 3 anchors of the head
+ * @param stride_x [in] Model input pixels per grid cell, horizontally
+ * @param stride_y [in] Model input pixels per grid cell, vertically
+ * @param zp [in] Zero point of the head
+ * @param scale [in] Scale of the head
+ */
+void build_head_lut(head_lut_t *lut, const int *anchor, int stride_x, int stride_y, int32_t zp, float scale);
+
+/**
+ * @brief Decoder of the head family of these outputs: YOLOv5 anchor heads, or the
+ *        anchor-free YOLOv8 branches (box distributions, class scores and an optional score sum)
+ *
+ * @param io_num [in] Input/output count of the model
+ * @param output_attrs [in] Output attrs
+ * @return const head_decoder_t* decoder; NULL: no decoder reads these outputs
+ */
+const head_decoder_t *find_head_decoder(const rknn_input_output_num *io_num, const rknn_tensor_attr *output_attrs);
+
+/**
+ * @brief Build app_ctx->decode from the output attrs with the decoder find_head_decoder picks,
+ *        call once the model is loaded
+ *
+ * @param app_ctx [in/out] Model context
+ * @return int 0: success; -1: error
+ */
+int init_yolov5_decode(rknn_app_context_t *app_ctx);
+
+/**
+ * @brief Decode only these classes when a post_process call brings no allowlist of its own;
+ *        the other class channels are not read and a box takes its best allowed class
+ *
+ * @param app_ctx [in/out] Model context with app_ctx->decode built
+ * @param class_ids [in] Class ids, out of range ones are skipped; NULL: every class
+ * @param num_class_ids [in] Entries of class_ids, 0: every class
+ * @return int 0: success; -1: error
+ */
+int set_yolov5_decode_classes(rknn_app_context_t *app_ctx, const int *class_ids, int num_class_ids);
+
+/**
+ * @brief Element type of output i as post_process reads it: int8 for quantized models,
+ *        the native fp16 for fp16 heads, float32 otherwise
+ *
+ * @param app_ctx [in] Model context with the output attrs
+ * @param i [in] Output index
+ * @return rknn_tensor_type RKNN_TENSOR_INT8, RKNN_TENSOR_FLOAT16 or RKNN_TENSOR_FLOAT32
+ */
+rknn_tensor_type yolov5_output_type(const rknn_app_context_t *app_ctx, int i);
+
+/**
+ * @brief Free app_ctx->decode
+ *
+ * @param app_ctx [in/out] Model context
+ */
+void release_yolov5_decode(rknn_app_context_t *app_ctx);
+
 void deInit_post_process();
 
 char *coco_cls_to_name(int cls_id);
 
+/**
+ * @brief Fill opts with the default thresholds and limits, every class allowed
+ *
+ * @param opts [out] Options
+ */
+void default_detect_options(detect_options_t *opts);
+
+/**
+ * @brief Decode the heads, keep the best boxes after NMS and map them back to the source image
+ *
+ * @param app_ctx [in/out] Model context, app_ctx->decode built by init_yolov5_decode
+ * @param outputs [in] Head buffers, of the type yolov5_output_type reports
+ * @param letter_box [in] Letterbox of the frame
+ * @param opts [in] Thresholds and limits of this call, NULL for default_detect_options
+ * @param od_results [out] Detections
+ * @return int 0: success; -1: error
+ */
 int post_process(rknn_app_context_t *app_ctx, void **outputs, letterbox_t *letter_box,
-                 float conf_threshold, float nms_threshold, object_detect_result_list *od_results);
+                 const detect_options_t *opts, object_detect_result_list *od_results);
 
 void deinitPostProcess();
 
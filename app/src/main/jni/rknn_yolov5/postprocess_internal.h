@@ -0,0 +1,120 @@
+#ifndef _RKNN_YOLOV5_DEMO_POSTPROCESS_INTERNAL_H_
+#define _RKNN_YOLOV5_DEMO_POSTPROCESS_INTERNAL_H_
+
+// Stage kernels of post_process(), exposed for the host benchmarks only.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "postprocess.h"
+
+// Head decoders, append the candidates of one head to cand and return their count;
+// cand has room for a candidate per anchor. process_i8, process_fp32 and process_f16 read
+// NCHW heads, process_i8_rv1106, process_fp32_nhwc and process_f16_nhwc NHWC heads.
+int process_i8(int8_t *input, const head_lut_t *lut, int grid_h, int grid_w, int num_classes,
+               candidate_arena_t *cand, float threshold);
+
+int process_i8_rv1106(int8_t *input, const head_lut_t *lut, int grid_h, int grid_w, int num_classes,
+                      candidate_arena_t *cand, float threshold);
+
+int process_fp32(float *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+                 candidate_arena_t *cand, float threshold);
+
+int process_fp32_nhwc(float *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+                      candidate_arena_t *cand, float threshold);
+
+// fp16 heads, the raw half bits
+int process_f16(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+                candidate_arena_t *cand, float threshold);
+
+int process_f16_nhwc(uint16_t *input, int *anchor, int grid_h, int grid_w, int num_classes, int stride,
+                     candidate_arena_t *cand, float threshold);
+
+/**
+ * @brief Softmax expectation of the bins of a box side distribution, sum(k * e^x[k]) / sum(e^x[k]),
+ *        vectorized when n is a multiple of the SIMD width
+ *
+ * @param x [in] Bin logits
+ * @param n [in] Bin count, at most DFL_LEN_MAX
+ * @return float distance of the side from the cell center, in cells
+ */
+float dfl_expect(const float *x, int n);
+
+// same with expf, one bin at a time
+float dfl_expect_scalar(const float *x, int n);
+
+// float bits mapped so that ascending unsigned order is descending score
+static inline uint32_t score_key(float score) {
+    uint32_t u;
+    memcpy(&u, &score, sizeof(u));
+    u = (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+    return ~u;
+}
+
+/**
+ * @brief Indices of the k best scores, picked with nth_element and then sorted
+ *
+ * @param scores [in] Candidate scores
+ * @param count [in] Candidate count
+ * @param k [in] Indices to keep, <= 0 or > count: all
+ * @param order [out] count ints, the first min(k, count) hold the indices, best first,
+ *                    equal scores in index order
+ * @return int indices written
+ */
+int topk_indices(const float *scores, int count, int k, int *order);
+
+/**
+ * @brief Same result as topk_indices with a stable LSD radix sort of all scores,
+ *        linear in count and unaffected by the many equal quantized scores
+ *
+ * @param score_keys [in] Candidate scores as candidate_arena_t.qscore keys
+ * @param count [in] Candidate count
+ * @param k [in] Indices to keep, <= 0 or > count: all
+ * @param order [out] count ints, the first min(k, count) hold the indices
+ * @param scratch [in] 3 * count words of workspace
+ * @return int indices written
+ */
+int radix_topk_indices(const uint32_t *score_keys, int count, int k, int *order, uint32_t *scratch);
+
+/**
+ * @brief Candidate boxes, one array per field, visited in descending score order
+ *
+ */
+typedef struct {
+    int count;      // boxes to visit
+    float *x1;
+    float *y1;
+    float *x2;
+    float *y2;
+    float *area;    // (x2 - x1 + 1) * (y2 - y1 + 1)
+    int *cls;
+    int *order;     // count box indices, best first; NULL: the arrays are in score order
+} nms_boxes_t;
+
+/**
+ * @brief Class-aware greedy NMS in a single pass over the sorted boxes
+ *
+ * @param boxes [in] Candidates, best score first
+ * @param threshold [in] A box overlapping a kept box of its class by IoU > threshold is dropped
+ * @param max_keep [in] Stop once this many boxes are kept, at most OBJ_NUMB_MAX_SIZE
+ * @param keep [out] Box indices of the kept ones, in score order
+ * @return int kept count
+ */
+int nms(const nms_boxes_t *boxes, float threshold, int max_keep, int *keep);
+
+/**
+ * @brief Same as nms(), testing each box only against the kept boxes bucketed in the grid
+ *        cells it covers. BM_nms_engines compares both on crowded frames.
+ *
+ * @param boxes [in] Candidates, best score first
+ * @param threshold [in] A box overlapping a kept box of its class by IoU > threshold is dropped
+ * @param max_keep [in] Stop once this many boxes are kept, at most OBJ_NUMB_MAX_SIZE
+ * @param grid_width [in] Extent of the grid, the model input width
+ * @param grid_height [in] Extent of the grid, the model input height
+ * @param keep [out] Box indices of the kept ones, in score order
+ * @return int kept count
+ */
+int nms_grid(const nms_boxes_t *boxes, float threshold, int max_keep, int grid_width,
+             int grid_height, int *keep);
+
+#endif //_RKNN_YOLOV5_DEMO_POSTPROCESS_INTERNAL_H_
@@ -3,11 +3,13 @@
 
 #include <jni.h>
 
+#include <pthread.h>
 #include <sys/time.h>
 #include <string>
 #include <vector>
 #include "yolov5.h"
 #include "yolov5_zerocopy.h"
+#include "tensor_record.h"
 #include "utils/image_drawing.h"
 
 extern "C" {
@@ -16,6 +18,17 @@ static rknn_app_context_t rknn_app_ctx;
 
 static bool use_zero_copy;
 
+static int zero_copy_output_layout = ZEROCOPY_OUTPUT_AUTO;
+
+// options of the following detect() calls, class_allowlist points into detect_classes
+static detect_options_t detect_options = {BOX_THRESH, NMS_THRESH, OBJ_NUMB_MAX_SIZE, PRE_NMS_TOPK, NULL, 0};
+
+static std::vector<int> detect_classes;
+
+// held by detect() through the inference, the setters of the options and of the decode
+// settings it reads take it too
+static pthread_mutex_t detect_lock = PTHREAD_MUTEX_INITIALIZER;
+
 JNIEXPORT jint
 JNI_OnLoad(JavaVM *vm, void *reserved) {
     LOGD("JNI_OnLoad");
@@ -38,6 +51,7 @@ Java_com_herohan_rknn_1yolov5_YoloV5Detect_init(JNIEnv *env, jobject thiz, jstri
     memset(&rknn_app_ctx, 0, sizeof(rknn_app_context_t));
 
     use_zero_copy = juse_zero_copy;
+    rknn_app_ctx.output_layout = zero_copy_output_layout;
 
     init_post_process(labelListPath);
 
@@ -87,9 +101,11 @@ Java_com_herohan_rknn_1yolov5_YoloV5Detect_detect(JNIEnv *env, jobject thiz, job
 //    for (int i = 0; i < 10; ++i) {
     int64_t start_us = getCurrentTimeUs();
 
+    pthread_mutex_lock(&detect_lock);
     ret = use_zero_copy ?
-          inference_yolov5_model_zerocopy(&rknn_app_ctx, &src_image, &od_results)
-                        : inference_yolov5_model(&rknn_app_ctx, &src_image, &od_results);
+          inference_yolov5_model_zerocopy(&rknn_app_ctx, &src_image, &detect_options, &od_results)
+                        : inference_yolov5_model(&rknn_app_ctx, &src_image, &detect_options, &od_results);
+    pthread_mutex_unlock(&detect_lock);
 
     int64_t elapse_us = getCurrentTimeUs() - start_us;
     LOGI("Total Elapse Time = %.2fms, FPS = %.2f\n", elapse_us / 1000.f,
@@ -125,6 +141,107 @@ Java_com_herohan_rknn_1yolov5_YoloV5Detect_detect(JNIEnv *env, jobject thiz, job
     return JNI_TRUE;
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_herohan_rknn_1yolov5_YoloV5Detect_startTensorRecord(JNIEnv *env, jobject thiz,
+                                                             jstring jrecord_path) {
+    const char *recordPath = env->GetStringUTFChars(jrecord_path, 0);
+    // detect() writes frames to the recorder under the lock, start replaces it
+    pthread_mutex_lock(&detect_lock);
+    int ret = tensor_record_start(&rknn_app_ctx, recordPath);
+    pthread_mutex_unlock(&detect_lock);
+    env->ReleaseStringUTFChars(jrecord_path, recordPath);
+    if (ret != 0) {
+        LOGE("tensor_record_start fail! ret=%d\n", ret);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_herohan_rknn_1yolov5_YoloV5Detect_stopTensorRecord(JNIEnv *env, jobject thiz) {
+    pthread_mutex_lock(&detect_lock);
+    int frame_count = tensor_record_stop(&rknn_app_ctx);
+    pthread_mutex_unlock(&detect_lock);
+    return frame_count;
+}
+
+JNIEXPORT void JNICALL
+Java_com_herohan_rknn_1yolov5_YoloV5Detect_setPreprocessBands(JNIEnv *env, jobject thiz,
+                                                              jint bands) {
+    if (bands <= 0) {
+        LOGE("setPreprocessBands: invalid bands %d, keep %d\n", bands, rknn_app_ctx.preprocess.bands);
+        return;
+    }
+    pthread_mutex_lock(&detect_lock);
+    rknn_app_ctx.preprocess.bands = bands;
+    pthread_mutex_unlock(&detect_lock);
+}
+
+JNIEXPORT void JNICALL
+Java_com_herohan_rknn_1yolov5_YoloV5Detect_setNmsEngine(JNIEnv *env, jobject thiz, jint engine) {
+    if (rknn_app_ctx.decode == NULL) {
+        LOGE("setNmsEngine before init!\n");
+        return;
+    }
+    if (engine != NMS_ENGINE_EXHAUSTIVE && engine != NMS_ENGINE_GRID) {
+        LOGE("setNmsEngine: unknown engine %d, keep %d\n", engine, rknn_app_ctx.decode->nms_engine);
+        return;
+    }
+    pthread_mutex_lock(&detect_lock);
+    rknn_app_ctx.decode->nms_engine = engine;
+    pthread_mutex_unlock(&detect_lock);
+}
+
+JNIEXPORT void JNICALL
+Java_com_herohan_rknn_1yolov5_YoloV5Detect_setDetectOptions(JNIEnv *env, jobject thiz,
+                                                            jfloat conf_threshold, jfloat nms_threshold,
+                                                            jint max_detections, jint pre_nms_topk,
+                                                            jintArray jclass_allowlist) {
+    std::vector<int> class_ids;
+    if (jclass_allowlist != NULL) {
+        class_ids.resize(env->GetArrayLength(jclass_allowlist));
+        env->GetIntArrayRegion(jclass_allowlist, 0, class_ids.size(), class_ids.data());
+    }
+    pthread_mutex_lock(&detect_lock);
+    detect_classes.swap(class_ids);
+    detect_options.conf_threshold = conf_threshold;
+    detect_options.nms_threshold = nms_threshold;
+    detect_options.max_detections = max_detections;
+    detect_options.pre_nms_topk = pre_nms_topk;
+    detect_options.class_allowlist = detect_classes.empty() ? NULL : detect_classes.data();
+    detect_options.num_allowed_classes = detect_classes.size();
+    pthread_mutex_unlock(&detect_lock);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_herohan_rknn_1yolov5_YoloV5Detect_setDecodeClasses(JNIEnv *env, jobject thiz,
+                                                            jintArray jclass_ids) {
+    if (rknn_app_ctx.decode == NULL) {
+        LOGE("setDecodeClasses before init!\n");
+        return JNI_FALSE;
+    }
+    std::vector<int> class_ids;
+    if (jclass_ids != NULL) {
+        class_ids.resize(env->GetArrayLength(jclass_ids));
+        env->GetIntArrayRegion(jclass_ids, 0, class_ids.size(), class_ids.data());
+    }
+    pthread_mutex_lock(&detect_lock);
+    int ret = set_yolov5_decode_classes(&rknn_app_ctx, class_ids.empty() ? NULL : class_ids.data(),
+                                        class_ids.size());
+    pthread_mutex_unlock(&detect_lock);
+    return ret == 0 ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_herohan_rknn_1yolov5_YoloV5Detect_setZeroCopyOutputLayout(JNIEnv *env, jobject thiz,
+                                                                   jint layout) {
+    if (layout != ZEROCOPY_OUTPUT_AUTO && layout != ZEROCOPY_OUTPUT_NCHW && layout != ZEROCOPY_OUTPUT_NHWC) {
+        LOGE("setZeroCopyOutputLayout: unknown layout %d, keep %d\n", layout, zero_copy_output_layout);
+        return;
+    }
+    zero_copy_output_layout = layout;
+}
+
 JNIEXPORT jboolean JNICALL
 Java_com_herohan_rknn_1yolov5_YoloV5Detect_release(JNIEnv *env, jobject thiz) {
     deInit_post_process();
@@ -0,0 +1,270 @@
+#include "tensor_record.h"
+#include "postprocess.h"
+#include "decode_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+struct tensor_recorder {
+    FILE *fp;
+    int frame_count;
+    std::vector<uint32_t> frame_bytes;
+};
+
+struct tensor_replay {
+    FILE *fp;
+    long first_frame;
+    std::vector<std::vector<uint8_t> > buffers;
+};
+
+typedef struct {
+    uint32_t n_dims;
+    uint32_t dims[4];
+    int32_t fmt;
+    int32_t type;
+    int32_t zp;
+    float scale;
+    uint32_t n_elems;
+    uint32_t frame_bytes;
+} record_attr_t;
+
+typedef struct {
+    int32_t anchors[3][6];
+    int32_t strides[3];
+    int32_t num_classes;
+    int32_t pad_color;
+} record_config_t;
+
+typedef struct {
+    int32_t x_pad;
+    int32_t y_pad;
+    float scale;
+} record_letterbox_t;
+
+// post_process() gets int8 for quantized models, fp16 for fp16 heads and float32 otherwise
+static uint32_t output_frame_bytes(rknn_app_context_t *app_ctx, int i) {
+    rknn_tensor_type type = yolov5_output_type(app_ctx, i);
+    size_t elem_size = type == RKNN_TENSOR_FLOAT32 ? sizeof(float) :
+                       type == RKNN_TENSOR_FLOAT16 ? sizeof(uint16_t) : sizeof(int8_t);
+    return app_ctx->output_attrs[i].n_elems * elem_size;
+}
+
+int tensor_record_start(rknn_app_context_t *app_ctx, const char *path) {
+    if (app_ctx == NULL || app_ctx->output_attrs == NULL || path == NULL) {
+        return -1;
+    }
+    tensor_record_stop(app_ctx);
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        LOGE("open %s fail!\n", path);
+        return -1;
+    }
+
+    tensor_recorder *rec = new tensor_recorder();
+    rec->fp = fp;
+    rec->frame_count = 0;
+
+    uint32_t header[6];
+    memcpy(&header[0], TENSOR_RECORD_MAGIC, 4);
+    header[1] = TENSOR_RECORD_VERSION;
+    header[2] = app_ctx->io_num.n_output;
+    header[3] = app_ctx->model_width;
+    header[4] = app_ctx->model_height;
+    header[5] = app_ctx->model_channel | (app_ctx->is_quant ? 0x80000000u : 0);
+    fwrite(header, sizeof(header), 1, fp);
+
+    for (uint32_t i = 0; i < app_ctx->io_num.n_output; i++) {
+        rknn_tensor_attr *attr = &app_ctx->output_attrs[i];
+        record_attr_t ra;
+        memset(&ra, 0, sizeof(ra));
+        ra.n_dims = attr->n_dims < 4 ? attr->n_dims : 4;
+        memcpy(ra.dims, attr->dims, ra.n_dims * sizeof(uint32_t));
+        ra.fmt = attr->fmt;
+        ra.type = app_ctx->is_quant ? attr->type : yolov5_output_type(app_ctx, i);
+        ra.zp = attr->zp;
+        ra.scale = attr->scale;
+        ra.n_elems = attr->n_elems;
+        ra.frame_bytes = output_frame_bytes(app_ctx, i);
+        rec->frame_bytes.push_back(ra.frame_bytes);
+        fwrite(&ra, sizeof(ra), 1, fp);
+    }
+
+    const decode_config_t *config = yolov5_decode_config(app_ctx);
+    record_config_t rc;
+    memcpy(rc.anchors, config->anchors, sizeof(rc.anchors));
+    memcpy(rc.strides, config->strides, sizeof(rc.strides));
+    rc.num_classes = config->num_classes;
+    rc.pad_color = config->pad_color;
+    fwrite(&rc, sizeof(rc), 1, fp);
+    if (ferror(fp)) {
+        LOGE("write %s fail!\n", path);
+        fclose(fp);
+        delete rec;
+        return -1;
+    }
+
+    app_ctx->recorder = rec;
+    LOGI("tensor record start: %s\n", path);
+    return 0;
+}
+
+int tensor_record_write(rknn_app_context_t *app_ctx, void **outputs, letterbox_t *letter_box) {
+    tensor_recorder *rec = app_ctx->recorder;
+    if (rec == NULL) {
+        return 0;
+    }
+    record_letterbox_t lb;
+    lb.x_pad = letter_box->x_pad;
+    lb.y_pad = letter_box->y_pad;
+    lb.scale = letter_box->scale;
+    fwrite(&lb, sizeof(lb), 1, rec->fp);
+    for (size_t i = 0; i < rec->frame_bytes.size(); i++) {
+        fwrite(outputs[i], 1, rec->frame_bytes[i], rec->fp);
+    }
+    if (ferror(rec->fp)) {
+        LOGE("tensor record write fail, stop recording\n");
+        tensor_record_stop(app_ctx);
+        return -1;
+    }
+    rec->frame_count++;
+    return 0;
+}
+
+int tensor_record_stop(rknn_app_context_t *app_ctx) {
+    if (app_ctx == NULL || app_ctx->recorder == NULL) {
+        return 0;
+    }
+    tensor_recorder *rec = app_ctx->recorder;
+    int frame_count = rec->frame_count;
+    fclose(rec->fp);
+    delete rec;
+    app_ctx->recorder = NULL;
+    LOGI("tensor record stop: %d frames\n", frame_count);
+    return frame_count;
+}
+
+tensor_replay_t *tensor_replay_open(const char *path, rknn_app_context_t *app_ctx) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("open %s fail!\n", path);
+        return NULL;
+    }
+
+    uint32_t header[6];
+    if (fread(header, sizeof(header), 1, fp) != 1 ||
+        memcmp(&header[0], TENSOR_RECORD_MAGIC, 4) != 0 || header[2] == 0 || header[2] > 16) {
+        printf("%s is not a tensor record file\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    // older records lack the decode config, replaying them with the defaults would decode
+    // a retrained model wrong
+    if (header[1] != TENSOR_RECORD_VERSION) {
+        printf("%s: record version %u, expect %d, record it again\n", path, header[1], TENSOR_RECORD_VERSION);
+        fclose(fp);
+        return NULL;
+    }
+
+    uint32_t n_output = header[2];
+    rknn_tensor_attr *attrs = (rknn_tensor_attr *) calloc(n_output, sizeof(rknn_tensor_attr));
+    tensor_replay *replay = new tensor_replay();
+    replay->fp = fp;
+    replay->buffers.resize(n_output);
+    for (uint32_t i = 0; i < n_output; i++) {
+        record_attr_t ra;
+        if (fread(&ra, sizeof(ra), 1, fp) != 1 || ra.n_dims > 4) {
+            printf("%s: truncated header\n", path);
+            free(attrs);
+            fclose(fp);
+            delete replay;
+            return NULL;
+        }
+        attrs[i].index = i;
+        attrs[i].n_dims = ra.n_dims;
+        memcpy(attrs[i].dims, ra.dims, sizeof(ra.dims));
+        attrs[i].fmt = (rknn_tensor_format) ra.fmt;
+        attrs[i].type = (rknn_tensor_type) ra.type;
+        attrs[i].qnt_type = ra.type == RKNN_TENSOR_FLOAT32 || ra.type == RKNN_TENSOR_FLOAT16
+                            ? RKNN_TENSOR_QNT_NONE : RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+        attrs[i].zp = ra.zp;
+        attrs[i].scale = ra.scale;
+        attrs[i].n_elems = ra.n_elems;
+        attrs[i].size = ra.frame_bytes;
+        replay->buffers[i].resize(ra.frame_bytes);
+    }
+    record_config_t rc;
+    decode_config_t *config = (decode_config_t *) malloc(sizeof(decode_config_t));
+    if (fread(&rc, sizeof(rc), 1, fp) != 1 || config == NULL) {
+        printf("%s: truncated header\n", path);
+        free(config);
+        free(attrs);
+        fclose(fp);
+        delete replay;
+        return NULL;
+    }
+    default_decode_config(config);
+    memcpy(config->anchors, rc.anchors, sizeof(config->anchors));
+    memcpy(config->strides, rc.strides, sizeof(config->strides));
+    config->num_classes = rc.num_classes;
+    config->pad_color = rc.pad_color;
+    replay->first_frame = ftell(fp);
+
+    memset(app_ctx, 0, sizeof(rknn_app_context_t));
+    app_ctx->io_num.n_output = n_output;
+    app_ctx->output_attrs = attrs;
+    app_ctx->model_width = header[3];
+    app_ctx->model_height = header[4];
+    app_ctx->model_channel = header[5] & 0x7fffffff;
+    app_ctx->is_quant = (header[5] & 0x80000000u) != 0;
+    app_ctx->decode_config = config;
+    if (init_yolov5_decode(app_ctx) != 0) {
+        tensor_replay_close(replay, app_ctx);
+        return NULL;
+    }
+    return replay;
+}
+
+int tensor_replay_next(tensor_replay_t *replay, void **outputs, letterbox_t *letter_box) {
+    record_letterbox_t lb;
+    if (fread(&lb, sizeof(lb), 1, replay->fp) != 1) {
+        return feof(replay->fp) ? 0 : -1;
+    }
+    for (size_t i = 0; i < replay->buffers.size(); i++) {
+        std::vector<uint8_t> &buf = replay->buffers[i];
+        if (fread(buf.data(), 1, buf.size(), replay->fp) != buf.size()) {
+            return -1;
+        }
+        outputs[i] = buf.data();
+    }
+    letter_box->x_pad = lb.x_pad;
+    letter_box->y_pad = lb.y_pad;
+    letter_box->scale = lb.scale;
+    return 1;
+}
+
+int tensor_replay_rewind(tensor_replay_t *replay) {
+    clearerr(replay->fp);
+    return fseek(replay->fp, replay->first_frame, SEEK_SET) == 0 ? 0 : -1;
+}
+
+void tensor_replay_close(tensor_replay_t *replay, rknn_app_context_t *app_ctx) {
+    if (replay != NULL) {
+        fclose(replay->fp);
+        delete replay;
+    }
+    if (app_ctx != NULL) {
+        release_yolov5_decode(app_ctx);
+    }
+    if (app_ctx != NULL && app_ctx->output_attrs != NULL) {
+        free(app_ctx->output_attrs);
+        app_ctx->output_attrs = NULL;
+    }
+    if (app_ctx != NULL) {
+        free(app_ctx->decode_config);
+        app_ctx->decode_config = NULL;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef _RKNN_YOLOV5_DEMO_TENSOR_RECORD_H_
+#define _RKNN_YOLOV5_DEMO_TENSOR_RECORD_H_
+
+#include <stdint.h>
+#include "utils/common.h"
+#include "utils/image_utils.h"
+
+/*
+ * Recorded tensor file layout (little endian):
+ *
+ *   header  "RKTR", version, n_output, model w/h/c, is_quant
+ *   attrs   per output: n_dims, dims[4], fmt, type, zp, scale, n_elems, frame bytes
+ *   config  decode config of the model: anchors[3][6], strides[3], num_classes, pad_color;
+ *           the attrs are already in the order of its output slots
+ *   frames  letterbox (x_pad, y_pad, scale) followed by the raw bytes of every output,
+ *           exactly as handed to post_process()
+ */
+#define TENSOR_RECORD_MAGIC "RKTR"
+#define TENSOR_RECORD_VERSION 2
+
+typedef struct tensor_replay tensor_replay_t;
+
+/**
+ * @brief Start recording the outputs of every following inference into path
+ *
+ * @param app_ctx [in] Initialized model context, owns the recorder until stopped
+ * @param path [in] Record file path, truncated if it exists
+ * @return int 0: success; -1: error
+ */
+int tensor_record_start(rknn_app_context_t *app_ctx, const char *path);
+
+/**
+ * @brief Append one frame, called by inference_yolov5_model*() before post_process()
+ *
+ * @param app_ctx [in] Model context
+ * @param outputs [in] Output buffers handed to post_process()
+ * @param letter_box [in] Letterbox of the frame
+ * @return int 0: success or not recording; -1: error
+ */
+int tensor_record_write(rknn_app_context_t *app_ctx, void **outputs, letterbox_t *letter_box);
+
+/**
+ * @brief Stop recording and close the file, safe to call when not recording
+ *
+ * @param app_ctx [in] Model context
+ * @return int recorded frame count
+ */
+int tensor_record_stop(rknn_app_context_t *app_ctx);
+
+/**
+ * @brief Open a record file and set up app_ctx so post_process() can run on its frames
+ *
+ * @param path [in] Record file path
+ * @param app_ctx [out] Zeroed context, gets output attrs, model size, quant flag and decode config
+ * @return tensor_replay_t* replay handle, NULL on error
+ */
+tensor_replay_t *tensor_replay_open(const char *path, rknn_app_context_t *app_ctx);
+
+/**
+ * @brief Read the next frame
+ *
+ * @param replay [in] Replay handle
+ * @param outputs [out] Output buffers, valid until the next call
+ * @param letter_box [out] Letterbox of the frame
+ * @return int 1: got a frame; 0: end of file; -1: error
+ */
+int tensor_replay_next(tensor_replay_t *replay, void **outputs, letterbox_t *letter_box);
+
+/**
+ * @brief Seek back to the first frame
+ *
+ * @param replay [in] Replay handle
+ * @return int 0: success; -1: error
+ */
+int tensor_replay_rewind(tensor_replay_t *replay);
+
+/**
+ * @brief Close the replay and release what tensor_replay_open() set up in app_ctx
+ *
+ * @param replay [in] Replay handle
+ * @param app_ctx [in] Context passed to tensor_replay_open()
+ */
+void tensor_replay_close(tensor_replay_t *replay, rknn_app_context_t *app_ctx);
+
+#endif //_RKNN_YOLOV5_DEMO_TENSOR_RECORD_H_
@@ -44,6 +44,52 @@ typedef struct {
     int bottom;
 } image_rect_t;
 
+struct tensor_recorder;
+struct yolov5_decode;
+struct decode_config;
+struct thread_pool;
+struct image_resize_cache;
+struct image_rga_cache;
+
+#define IMAGE_PREPROCESS_MAX_BANDS 16
+
+/**
+ * @brief Letterbox state kept across frames
+ * 
+ */
+typedef struct {
+    struct thread_pool* pool;   // runs the CPU bands, NULL: calling thread only
+    int bands;                  // horizontal bands of the target box on the CPU path
+    int band_count;             // bands of the last conversion, 0 when it went through RGA
+    int64_t band_us[IMAGE_PREPROCESS_MAX_BANDS];
+
+    // pad painted by the last conversion; the target buffer is assumed to be written by
+    // nothing else, so the same geometry and color skip the repaint. 0 forces a repaint.
+    int pad_valid;
+    void* pad_addr;
+    int pad_fd;
+    int pad_width;
+    int pad_height;
+    int pad_stride;
+    int pad_format;
+    char pad_color;
+    image_rect_t pad_box;
+
+    // letterbox geometry of the last src/dst size
+    int lb_valid;
+    int lb_src_width;
+    int lb_src_height;
+    int lb_dst_width;
+    int lb_dst_height;
+    image_rect_t lb_box;
+    float lb_scale;
+    int lb_x_pad;
+    int lb_y_pad;
+
+    struct image_resize_cache* resize_cache;    // CPU resize tables and band workspaces
+    struct image_rga_cache* rga_cache;          // imported RGA buffer handles
+} image_preprocess_t;
+
 typedef struct {
     rknn_context rknn_ctx;
     rknn_input_output_num io_num;
@@ -55,6 +101,13 @@ typedef struct {
     int model_width;
     int model_height;
     uint8_t is_quant;
+    struct tensor_recorder* recorder;
+    struct decode_config* decode_config;    // anchors, strides, ... loaded with the model, NULL: defaults
+    struct yolov5_decode* decode;   // decode tables, built by init_yolov5_model*
+    image_buffer_t input_image;     // letterbox destination, allocated once by init_yolov5_model*
+    struct thread_pool* pool;       // worker threads, created by init_yolov5_model*
+    int output_layout;              // zerocopy_output_layout_t, read by init_yolov5_model_zerocopy
+    image_preprocess_t preprocess;
 } rknn_app_context_t;
 
 static inline int64_t getCurrentTimeUs()
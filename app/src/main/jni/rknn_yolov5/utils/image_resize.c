@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGE_RESIZE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGE_RESIZE_SSE2
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IMAGE_RESIZE_AVX2
+#endif
+#endif
+
+#include "image_resize.h"
+#include "common.h"
+
+#define WEIGHT_ONE (1 << IMAGE_RESIZE_WEIGHT_BITS)
+#define V_SHIFT (IMAGE_RESIZE_WEIGHT_BITS * 2)
+#define V_ROUND (1 << (V_SHIFT - 1))
+
+// source index and Q7 weight pair of every target position, same sampling as the float kernel:
+// position i reads src[i * ratio] and its next neighbour, clamped at the source edge
+static void build_axis(int dst_size, int crop_start, int crop_size, int src_size, int scale,
+                       int* ofs, int32_t* w) {
+    float ratio = (float)crop_size / (float)dst_size;
+    for (int i = 0; i < dst_size; i++) {
+        float f = i * ratio;
+        int s = (int)f;
+        int w1 = (int)((f - s) * WEIGHT_ONE + 0.5f);
+        s += crop_start;
+        if (s > src_size - 1) {
+            s = src_size - 1;
+        }
+        int s1 = s + 1 < src_size ? s + 1 : s;
+        ofs[i * 2] = s * scale;
+        ofs[i * 2 + 1] = s1 * scale;
+        w[i] = (int32_t)((uint32_t)(WEIGHT_ONE - w1) | ((uint32_t)w1 << 16));
+    }
+}
+
+int image_resize_init(image_resize_t* rs, int src_channel, int dst_channel, int src_width, int src_height,
+                      int crop_x, int crop_y, int crop_width, int crop_height,
+                      int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+    memset(rs, 0, sizeof(image_resize_t));
+    if (src_channel < 1 || src_channel > 4 || dst_channel < 1 || dst_channel > src_channel ||
+        crop_width <= 0 || crop_height <= 0 || dst_box_width <= 0 || dst_box_height <= 0) {
+        LOGE("invalid resize src_channel=%d dst_channel=%d crop=%dx%d dst_box=%dx%d\n",
+             src_channel, dst_channel, crop_width, crop_height, dst_box_width, dst_box_height);
+        return -1;
+    }
+
+    size_t size = (size_t)dst_box_width * (2 * sizeof(int) + sizeof(int32_t)) +
+                  (size_t)dst_box_height * (2 * sizeof(int) + sizeof(int32_t));
+    unsigned char* tables = (unsigned char*)malloc(size);
+    if (tables == NULL) {
+        LOGE("malloc size %d error\n", (int)size);
+        return -1;
+    }
+    rs->x_ofs = (int*)tables;
+    rs->x_w = (int32_t*)(rs->x_ofs + dst_box_width * 2);
+    rs->y_ofs = (int*)(rs->x_w + dst_box_width);
+    rs->y_w = (int32_t*)(rs->y_ofs + dst_box_height * 2);
+
+    rs->src_channel = src_channel;
+    rs->dst_channel = dst_channel;
+    rs->src_width = src_width;
+    rs->src_height = src_height;
+    rs->dst_box_x = dst_box_x;
+    rs->dst_box_y = dst_box_y;
+    rs->dst_box_width = dst_box_width;
+    rs->dst_box_height = dst_box_height;
+    build_axis(dst_box_width, crop_x, crop_width, src_width, src_channel, rs->x_ofs, rs->x_w);
+    build_axis(dst_box_height, crop_y, crop_height, src_height, 1, rs->y_ofs, rs->y_w);
+
+    // the vector kernels load 4 bytes per source pixel, keep them inside the row
+    int row_bytes = src_width * src_channel;
+    rs->x_simd_end = 0;
+    while (rs->x_simd_end < dst_box_width && rs->x_ofs[rs->x_simd_end * 2 + 1] + 4 <= row_bytes) {
+        rs->x_simd_end++;
+    }
+    // they also store 4 lanes per pixel, the last pixel spills into the slack
+    rs->row_size = (dst_box_width * dst_channel + 4 + 15) & ~15;
+    return 0;
+}
+
+void image_resize_release(image_resize_t* rs) {
+    if (rs != NULL && rs->x_ofs != NULL) {
+        free(rs->x_ofs);
+        memset(rs, 0, sizeof(image_resize_t));
+    }
+}
+
+int image_resize_workspace_size(const image_resize_t* rs) {
+    return rs->row_size * 2 * (int)sizeof(int16_t);
+}
+
+// horizontal pass: one source row into Q7 int16 samples of the target columns
+static void resize_row_h(const image_resize_t* rs, const unsigned char* src_row, int16_t* out) {
+    const int* x_ofs = rs->x_ofs;
+    const int32_t* x_w = rs->x_w;
+    int dc = rs->dst_channel;
+    int x = 0;
+
+#if defined(IMAGE_RESIZE_NEON) || defined(IMAGE_RESIZE_SSE2)
+    // 4 lanes per pixel, the lanes past dst_channel are overwritten by the next pixel
+    if (dc > 1) {
+#if defined(IMAGE_RESIZE_SSE2)
+        __m128i zero = _mm_setzero_si128();
+#endif
+        for (; x < rs->x_simd_end; x++) {
+            uint32_t p0, p1;
+            memcpy(&p0, src_row + x_ofs[x * 2], 4);
+            memcpy(&p1, src_row + x_ofs[x * 2 + 1], 4);
+#if defined(IMAGE_RESIZE_NEON)
+            int16x4_t a = vreinterpret_s16_u16(vget_low_u16(vmovl_u8(vcreate_u8(p0))));
+            int16x4_t b = vreinterpret_s16_u16(vget_low_u16(vmovl_u8(vcreate_u8(p1))));
+            int32x4_t r = vmull_n_s16(a, (int16_t)(x_w[x] & 0xffff));
+            r = vmlal_n_s16(r, b, (int16_t)(x_w[x] >> 16));
+            vst1_s16(out + x * dc, vmovn_s32(r));
+#else
+            __m128i ab = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)p0), _mm_cvtsi32_si128((int)p1));
+            __m128i r = _mm_madd_epi16(_mm_unpacklo_epi8(ab, zero), _mm_set1_epi32(x_w[x]));
+            _mm_storel_epi64((__m128i*)(out + x * dc), _mm_packs_epi32(r, r));
+#endif
+        }
+    } else {
+        // single channel: gather 4 neighbour pairs, the packed weights load as they are
+        for (; x + 4 <= rs->dst_box_width; x += 4) {
+            const int* o = x_ofs + x * 2;
+#if defined(IMAGE_RESIZE_NEON)
+            int16_t a[4] = {src_row[o[0]], src_row[o[2]], src_row[o[4]], src_row[o[6]]};
+            int16_t b[4] = {src_row[o[1]], src_row[o[3]], src_row[o[5]], src_row[o[7]]};
+            int16x4x2_t w = vld2_s16((const int16_t*)(x_w + x));
+            int32x4_t r = vmull_s16(vld1_s16(a), w.val[0]);
+            r = vmlal_s16(r, vld1_s16(b), w.val[1]);
+            vst1_s16(out + x, vmovn_s32(r));
+#else
+            __m128i ab = _mm_setr_epi16(src_row[o[0]], src_row[o[1]], src_row[o[2]], src_row[o[3]],
+                                        src_row[o[4]], src_row[o[5]], src_row[o[6]], src_row[o[7]]);
+            __m128i r = _mm_madd_epi16(ab, _mm_loadu_si128((const __m128i*)(x_w + x)));
+            _mm_storel_epi64((__m128i*)(out + x), _mm_packs_epi32(r, r));
+#endif
+        }
+    }
+#endif
+
+    for (; x < rs->dst_box_width; x++) {
+        const unsigned char* p0 = src_row + x_ofs[x * 2];
+        const unsigned char* p1 = src_row + x_ofs[x * 2 + 1];
+        int w0 = x_w[x] & 0xffff;
+        int w1 = x_w[x] >> 16;
+        int16_t* o = out + x * dc;
+        for (int c = 0; c < dc; c++) {
+            o[c] = (int16_t)(p0[c] * w0 + p1[c] * w1);
+        }
+    }
+}
+
+// vertical pass: blend two horizontally resized rows into n target bytes
+static void resize_row_v(const int16_t* r0, const int16_t* r1, int32_t y_w, unsigned char* dst, int n) {
+    int i = 0;
+
+#if defined(IMAGE_RESIZE_AVX2)
+    __m256i w8 = _mm256_set1_epi32(y_w);
+    __m256i round8 = _mm256_set1_epi32(V_ROUND);
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(r0 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(r1 + i));
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w8);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w8);
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round8), V_SHIFT);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round8), V_SHIFT);
+        // unpack and pack both stay inside 128-bit lanes, so the order comes back
+        __m256i v = _mm256_packs_epi32(lo, hi);
+        __m128i u8 = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128((__m128i*)(dst + i), u8);
+    }
+#endif
+#if defined(IMAGE_RESIZE_SSE2)
+    __m128i w4 = _mm_set1_epi32(y_w);
+    __m128i round4 = _mm_set1_epi32(V_ROUND);
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(r0 + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(r1 + i));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w4);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w4);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round4), V_SHIFT);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round4), V_SHIFT);
+        __m128i v = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(v, v));
+    }
+#elif defined(IMAGE_RESIZE_NEON)
+    int16_t w0 = (int16_t)(y_w & 0xffff);
+    int16_t w1 = (int16_t)(y_w >> 16);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t a = vld1q_s16(r0 + i);
+        int16x8_t b = vld1q_s16(r1 + i);
+        int32x4_t lo = vmlal_n_s16(vmull_n_s16(vget_low_s16(a), w0), vget_low_s16(b), w1);
+        int32x4_t hi = vmlal_n_s16(vmull_n_s16(vget_high_s16(a), w0), vget_high_s16(b), w1);
+        int16x8_t v = vcombine_s16(vrshrn_n_s32(lo, V_SHIFT), vrshrn_n_s32(hi, V_SHIFT));
+        vst1_u8(dst + i, vqmovun_s16(v));
+    }
+#endif
+
+    int sw0 = y_w & 0xffff;
+    int sw1 = y_w >> 16;
+    for (; i < n; i++) {
+        int v = (r0[i] * sw0 + r1[i] * sw1 + V_ROUND) >> V_SHIFT;
+        dst[i] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+}
+
+void image_resize_run(const image_resize_t* rs, const unsigned char* src, unsigned char* dst, int dst_stride,
+                      int row_begin, int row_end, void* workspace) {
+    int16_t* rows[2] = {(int16_t*)workspace, (int16_t*)workspace + rs->row_size};
+    int row_y[2] = {-1, -1};
+    int src_row_bytes = rs->src_width * rs->src_channel;
+    int n = rs->dst_box_width * rs->dst_channel;
+
+    for (int y = row_begin; y < row_end; y++) {
+        int sy0 = rs->y_ofs[y * 2];
+        int sy1 = rs->y_ofs[y * 2 + 1];
+        // consecutive target rows mostly share source rows when upscaling
+        if (row_y[0] != sy0) {
+            if (row_y[1] == sy0) {
+                int16_t* t = rows[0];
+                rows[0] = rows[1];
+                rows[1] = t;
+                row_y[1] = row_y[0];
+                row_y[0] = sy0;
+            } else {
+                resize_row_h(rs, src + (size_t)sy0 * src_row_bytes, rows[0]);
+                row_y[0] = sy0;
+            }
+        }
+        if (row_y[1] != sy1) {
+            resize_row_h(rs, src + (size_t)sy1 * src_row_bytes, rows[1]);
+            row_y[1] = sy1;
+        }
+        unsigned char* dst_row = dst + ((size_t)(rs->dst_box_y + y) * dst_stride + rs->dst_box_x) * rs->dst_channel;
+        resize_row_v(rows[0], rows[1], rs->y_w[y], dst_row, n);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
+#define _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// interpolation weights are Q7, a horizontal sample fits int16 (255 * 128)
+#define IMAGE_RESIZE_WEIGHT_BITS 7
+
+/**
+ * @brief Bilinear resize of a crop of an interleaved 8-bit image into a box of another,
+ *        with the per-column and per-row source offsets and weights computed once
+ *
+ */
+typedef struct {
+    int src_channel;
+    int dst_channel;
+    int src_width;
+    int src_height;
+    int dst_box_x;
+    int dst_box_y;
+    int dst_box_width;
+    int dst_box_height;
+    int* x_ofs;         // [dst_box_width * 2] byte offsets of the left/right source pixels in a row
+    int32_t* x_w;       // [dst_box_width] Q7 weights of the left (low 16 bits) and right source pixel
+    int* y_ofs;         // [dst_box_height * 2] top/bottom source rows
+    int32_t* y_w;       // [dst_box_height] Q7 weights of the top (low 16 bits) and bottom source row
+    int x_simd_end;     // columns before it may load 4 bytes from their source pixels
+    int row_size;       // int16 elements of one horizontally resized row, slack included
+} image_resize_t;
+
+/**
+ * @brief Build the resize tables
+ *
+ * @param rs [out] Resize tables, release with image_resize_release
+ * @param src_channel [in] Channels of the source pixels (1-4)
+ * @param dst_channel [in] Leading channels written per target pixel (1-4, <= src_channel)
+ * @param src_width [in] Source image width
+ * @param src_height [in] Source image height
+ * @param crop_x [in] Crop rectangle on source image
+ * @param crop_y [in]
+ * @param crop_width [in]
+ * @param crop_height [in]
+ * @param dst_box_x [in] Target rectangle on target image
+ * @param dst_box_y [in]
+ * @param dst_box_width [in]
+ * @param dst_box_height [in]
+ * @return int 0: success; -1: error
+ */
+int image_resize_init(image_resize_t* rs, int src_channel, int dst_channel, int src_width, int src_height,
+                      int crop_x, int crop_y, int crop_width, int crop_height,
+                      int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height);
+
+/**
+ * @brief Free the resize tables
+ *
+ * @param rs [in] Resize tables
+ */
+void image_resize_release(image_resize_t* rs);
+
+/**
+ * @brief Bytes of the row workspace image_resize_run needs
+ *
+ * @param rs [in] Resize tables
+ * @return int workspace size
+ */
+int image_resize_workspace_size(const image_resize_t* rs);
+
+/**
+ * @brief Resize rows [row_begin, row_end) of the target box
+ *
+ * @param rs [in] Resize tables
+ * @param src [in] Source image, rows of src_width * src_channel bytes
+ * @param dst [out] Target image
+ * @param dst_stride [in] Row pitch of the target image in pixels
+ * @param row_begin [in] First row of the target box
+ * @param row_end [in] End row of the target box
+ * @param workspace [in] image_resize_workspace_size bytes, one per concurrent caller
+ */
+void image_resize_run(const image_resize_t* rs, const unsigned char* src, unsigned char* dst, int dst_stride,
+                      int row_begin, int row_end, void* workspace);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif // _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
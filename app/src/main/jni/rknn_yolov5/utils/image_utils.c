@@ -10,6 +10,9 @@
 #include "turbojpeg.h"
 
 #include "image_utils.h"
+#include "image_utils_internal.h"
+#include "image_resize.h"
+#include "thread_pool.h"
 #include "file_utils.h"
 
 static const char* filter_image_names[] = {
@@ -244,80 +247,59 @@ int write_image(const char* path, const image_buffer_t* img)
     return ret;
 }
 
-static int crop_and_scale_image_c(int channel, unsigned char *src, int src_width, int src_height,
-                                    int crop_x, int crop_y, int crop_width, int crop_height,
-                                    unsigned char *dst, int dst_width, int dst_height,
-                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+// bilinear scale reading src_channel and writing the first dst_channel channels of each pixel
+static int crop_and_scale_image_channels(int src_channel, int dst_channel,
+                                         unsigned char *src, int src_width, int src_height,
+                                         int crop_x, int crop_y, int crop_width, int crop_height,
+                                         unsigned char *dst, int dst_width, int dst_height,
+                                         int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
     if (dst == NULL) {
         LOGE("dst buffer is null\n");
         return -1;
     }
 
-    float x_ratio = (float)crop_width / (float)dst_box_width;
-    float y_ratio = (float)crop_height / (float)dst_box_height;
-
-    // LOGI("src_width=%d src_height=%d crop_x=%d crop_y=%d crop_width=%d crop_height=%d\n",
-    //     src_width, src_height, crop_x, crop_y, crop_width, crop_height);
-    // LOGI("dst_width=%d dst_height=%d dst_box_x=%d dst_box_y=%d dst_box_width=%d dst_box_height=%d\n",
-    //     dst_width, dst_height, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
-    // LOGI("channel=%d x_ratio=%f y_ratio=%f\n", channel, x_ratio, y_ratio);
-
-    // 从原图指定区域取数据，双线性缩放到目标指定区域
-    for (int dst_y = dst_box_y; dst_y < dst_box_y + dst_box_height; dst_y++) {
-        for (int dst_x = dst_box_x; dst_x < dst_box_x + dst_box_width; dst_x++) {
-            int dst_x_offset = dst_x - dst_box_x;
-            int dst_y_offset = dst_y - dst_box_y;
-
-            int src_x = (int)(dst_x_offset * x_ratio) + crop_x;
-            int src_y = (int)(dst_y_offset * y_ratio) + crop_y;
-
-            float x_diff = (dst_x_offset * x_ratio) - (src_x - crop_x);
-            float y_diff = (dst_y_offset * y_ratio) - (src_y - crop_y);
-
-            int index1 = src_y * src_width * channel + src_x * channel;
-            int index2 = index1 + src_width * channel;    // down
-            if (src_y == src_height - 1) {
-                // 如果到图像最下边缘，变成选择上面的像素
-                index2 = index1 - src_width * channel;
-            }
-            int index3 = index1 + 1 * channel;            // right
-            int index4 = index2 + 1 * channel;            // down right
-            if (src_x == src_width - 1) {
-                // 如果到图像最右边缘，变成选择左边的像素
-                index3 = index1 - 1 * channel;
-                index4 = index2 - 1 * channel;
-            }
-
-            // LOGI("dst_x=%d dst_y=%d dst_x_offset=%d dst_y_offset=%d src_x=%d src_y=%d x_diff=%f y_diff=%f src index=%d %d %d %d\n",
-            //     dst_x, dst_y, dst_x_offset, dst_y_offset,
-            //     src_x, src_y, x_diff, y_diff,
-            //     index1, index2, index3, index4);
-
-            for (int c = 0; c < channel; c++) {
-                unsigned char A = src[index1+c];
-                unsigned char B = src[index3+c];
-                unsigned char C = src[index2+c];
-                unsigned char D = src[index4+c];
-
-                unsigned char pixel = (unsigned char)(
-                    A * (1 - x_diff) * (1 - y_diff) +
-                    B * x_diff * (1 - y_diff) +
-                    C * y_diff * (1 - x_diff) +
-                    D * x_diff * y_diff
-                );
-
-                dst[(dst_y * dst_width  + dst_x) * channel + c] = pixel;
-            }
-        }
+    // 从原图指定区域取数据，双线性缩放到目标指定区域（定点查表实现，见image_resize.c）
+    image_resize_t rs;
+    if (image_resize_init(&rs, src_channel, dst_channel, src_width, src_height,
+                          crop_x, crop_y, crop_width, crop_height,
+                          dst_box_x, dst_box_y, dst_box_width, dst_box_height) != 0) {
+        return -1;
+    }
+    void* workspace = malloc(image_resize_workspace_size(&rs));
+    if (workspace == NULL) {
+        image_resize_release(&rs);
+        return -1;
     }
+    image_resize_run(&rs, src, dst, dst_width, 0, dst_box_height, workspace);
+    free(workspace);
+    image_resize_release(&rs);
 
     return 0;
 }
 
-static int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int src_height,
-                                    int crop_x, int crop_y, int crop_width, int crop_height,
-                                    unsigned char *dst, int dst_width, int dst_height,
-                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+int crop_and_scale_image_c(int channel, unsigned char *src, int src_width, int src_height,
+                           int crop_x, int crop_y, int crop_width, int crop_height,
+                           unsigned char *dst, int dst_width, int dst_height,
+                           int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+    return crop_and_scale_image_channels(channel, channel, src, src_width, src_height,
+        crop_x, crop_y, crop_width, crop_height, dst, dst_width, dst_height,
+        dst_box_x, dst_box_y, dst_box_width, dst_box_height);
+}
+
+int crop_and_scale_image_rgba_to_rgb(unsigned char *src, int src_width, int src_height,
+                                     int crop_x, int crop_y, int crop_width, int crop_height,
+                                     unsigned char *dst, int dst_width, int dst_height,
+                                     int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+    // alpha is the last channel, scaling only the first 3 drops it
+    return crop_and_scale_image_channels(4, 3, src, src_width, src_height,
+        crop_x, crop_y, crop_width, crop_height, dst, dst_width, dst_height,
+        dst_box_x, dst_box_y, dst_box_width, dst_box_height);
+}
+
+int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int src_height,
+                                  int crop_x, int crop_y, int crop_width, int crop_height,
+                                  unsigned char *dst, int dst_width, int dst_height,
+                                  int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
 
     unsigned char* src_y = src;
     unsigned char* src_uv = src + src_width * src_height;
@@ -329,12 +311,328 @@ static int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int
         dst_y, dst_width, dst_height, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
     
     crop_and_scale_image_c(2, src_uv, src_width / 2, src_height / 2, crop_x / 2, crop_y / 2, crop_width / 2, crop_height / 2,
-        dst_uv, dst_width / 2, dst_height / 2, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
+        dst_uv, dst_width / 2, dst_height / 2, dst_box_x / 2, dst_box_y / 2, dst_box_width / 2, dst_box_height / 2);
+
+    return 0;
+}
+
+static inline unsigned char clamp_u8(int v) {
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// rows [row_begin, row_end) of the target box
+static void yuv420sp_to_rgb_rows(int uv_swap, unsigned char *src, int src_width, int src_height, int src_stride,
+                                 int crop_x, int crop_y, int crop_width, int crop_height,
+                                 unsigned char *dst, int dst_width,
+                                 int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height,
+                                 int row_begin, int row_end) {
+    unsigned char* src_y = src;
+    // both planes have rows of src_stride bytes, the UV plane follows the src_height Y rows
+    unsigned char* src_uv = src + src_stride * src_height;
+    int uv_width = src_width / 2;
+    int uv_height = src_height / 2;
+    int u_off = uv_swap ? 1 : 0;
+    int v_off = uv_swap ? 0 : 1;
+
+    float x_ratio = (float)crop_width / (float)dst_box_width;
+    float y_ratio = (float)crop_height / (float)dst_box_height;
+
+    // 双线性采样Y与UV平面，再按BT.601 limited range（与RGA默认一致）转换为RGB
+    for (int dst_y = dst_box_y + row_begin; dst_y < dst_box_y + row_end; dst_y++) {
+        for (int dst_x = dst_box_x; dst_x < dst_box_x + dst_box_width; dst_x++) {
+            float fx = (dst_x - dst_box_x) * x_ratio + crop_x;
+            float fy = (dst_y - dst_box_y) * y_ratio + crop_y;
+
+            // luma
+            int x0 = (int)fx;
+            int y0 = (int)fy;
+            float x_diff = fx - x0;
+            float y_diff = fy - y0;
+            int x1 = x0 + 1 < src_width ? x0 + 1 : x0 - 1;
+            int y1 = y0 + 1 < src_height ? y0 + 1 : y0 - 1;
+            float luma =
+                src_y[y0 * src_stride + x0] * (1 - x_diff) * (1 - y_diff) +
+                src_y[y0 * src_stride + x1] * x_diff * (1 - y_diff) +
+                src_y[y1 * src_stride + x0] * y_diff * (1 - x_diff) +
+                src_y[y1 * src_stride + x1] * x_diff * y_diff;
+
+            // chroma, one interleaved UV pair per 2x2 luma block
+            float cfx = fx / 2;
+            float cfy = fy / 2;
+            int cx0 = (int)cfx;
+            int cy0 = (int)cfy;
+            if (cx0 >= uv_width) {
+                cx0 = uv_width - 1;
+            }
+            if (cy0 >= uv_height) {
+                cy0 = uv_height - 1;
+            }
+            float cx_diff = cfx - cx0;
+            float cy_diff = cfy - cy0;
+            int cx1 = cx0 + 1 < uv_width ? cx0 + 1 : cx0;
+            int cy1 = cy0 + 1 < uv_height ? cy0 + 1 : cy0;
+            unsigned char* p00 = src_uv + cy0 * src_stride + cx0 * 2;
+            unsigned char* p01 = src_uv + cy0 * src_stride + cx1 * 2;
+            unsigned char* p10 = src_uv + cy1 * src_stride + cx0 * 2;
+            unsigned char* p11 = src_uv + cy1 * src_stride + cx1 * 2;
+            float w00 = (1 - cx_diff) * (1 - cy_diff);
+            float w01 = cx_diff * (1 - cy_diff);
+            float w10 = (1 - cx_diff) * cy_diff;
+            float w11 = cx_diff * cy_diff;
+            float u = p00[u_off] * w00 + p01[u_off] * w01 + p10[u_off] * w10 + p11[u_off] * w11;
+            float v = p00[v_off] * w00 + p01[v_off] * w01 + p10[v_off] * w10 + p11[v_off] * w11;
+
+            // 10-bit fixed point BT.601 limited range
+            int c = ((int)luma - 16) * 1192;
+            int d = (int)u - 128;
+            int e = (int)v - 128;
+            unsigned char* out = dst + (dst_y * dst_width + dst_x) * 3;
+            out[0] = clamp_u8((c + 1634 * e + 512) >> 10);
+            out[1] = clamp_u8((c - 401 * d - 832 * e + 512) >> 10);
+            out[2] = clamp_u8((c + 2066 * d + 512) >> 10);
+        }
+    }
+}
+
+int crop_and_scale_image_yuv420sp_to_rgb(int uv_swap, unsigned char *src, int src_width, int src_height,
+                                         int src_stride, int crop_x, int crop_y, int crop_width, int crop_height,
+                                         unsigned char *dst, int dst_width, int dst_height,
+                                         int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+    if (dst == NULL) {
+        LOGE("dst buffer is null\n");
+        return -1;
+    }
+    yuv420sp_to_rgb_rows(uv_swap, src, src_width, src_height, src_stride, crop_x, crop_y, crop_width, crop_height,
+        dst, dst_width, dst_box_x, dst_box_y, dst_box_width, dst_box_height, 0, dst_box_height);
+    return 0;
+}
+
+// one horizontal band of the target box per pool task
+typedef struct {
+    const image_resize_t* rs;       // NULL: yuv420sp to rgb
+    unsigned char* workspace;       // workspace_size bytes per band
+    int workspace_size;
+    int uv_swap;
+    unsigned char* src;
+    int src_width;
+    int src_height;
+    int src_stride;                 // yuv420sp row bytes of both planes
+    int crop_x;
+    int crop_y;
+    int crop_width;
+    int crop_height;
+    unsigned char* dst;
+    int dst_stride;
+    int dst_box_x;
+    int dst_box_y;
+    int dst_box_width;
+    int dst_box_height;
+    int bands;
+    int64_t* band_us;
+} cpu_band_job_t;
+
+static void run_cpu_band(void* arg, int band) {
+    cpu_band_job_t* job = (cpu_band_job_t*)arg;
+    int row_begin = job->dst_box_height * band / job->bands;
+    int row_end = job->dst_box_height * (band + 1) / job->bands;
+    int64_t start_us = getCurrentTimeUs();
+    if (job->rs != NULL) {
+        image_resize_run(job->rs, job->src, job->dst, job->dst_stride, row_begin, row_end,
+                         job->workspace + (size_t)band * job->workspace_size);
+    } else {
+        yuv420sp_to_rgb_rows(job->uv_swap, job->src, job->src_width, job->src_height, job->src_stride,
+            job->crop_x, job->crop_y, job->crop_width, job->crop_height, job->dst, job->dst_stride,
+            job->dst_box_x, job->dst_box_y, job->dst_box_width, job->dst_box_height, row_begin, row_end);
+    }
+    job->band_us[band] = getCurrentTimeUs() - start_us;
+}
+
+// resize tables of the last letterbox and a workspace per band, rebuilt when the geometry changes
+struct image_resize_cache {
+    int key[12];
+    image_resize_t rs;
+    unsigned char* workspace;
+    int workspace_bands;
+};
+typedef struct image_resize_cache image_resize_cache_t;
 
+static void free_resize_cache(image_resize_cache_t* cache)
+{
+    if (cache->workspace != NULL) {
+        image_resize_release(&cache->rs);
+        free(cache->workspace);
+    }
+    free(cache);
+}
+
+static image_resize_cache_t* get_resize_cache(image_preprocess_t* pp, int src_channel, int dst_channel,
+                                              int src_width, int src_height,
+                                              int crop_x, int crop_y, int crop_width, int crop_height,
+                                              int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height,
+                                              int bands)
+{
+    int key[12] = {src_channel, dst_channel, src_width, src_height, crop_x, crop_y, crop_width, crop_height,
+                   dst_box_x, dst_box_y, dst_box_width, dst_box_height};
+    image_resize_cache_t* cache = pp->resize_cache;
+    if (cache != NULL && memcmp(cache->key, key, sizeof(key)) == 0) {
+        if (cache->workspace_bands >= bands) {
+            return cache;
+        }
+        // same tables, more bands
+        unsigned char* workspace = (unsigned char*)malloc((size_t)image_resize_workspace_size(&cache->rs) * bands);
+        if (workspace == NULL) {
+            return NULL;
+        }
+        free(cache->workspace);
+        cache->workspace = workspace;
+        cache->workspace_bands = bands;
+        return cache;
+    }
+    if (cache != NULL) {
+        free_resize_cache(cache);
+        pp->resize_cache = NULL;
+    }
+
+    cache = (image_resize_cache_t*)calloc(1, sizeof(image_resize_cache_t));
+    if (cache == NULL) {
+        return NULL;
+    }
+    if (image_resize_init(&cache->rs, src_channel, dst_channel, src_width, src_height,
+                          crop_x, crop_y, crop_width, crop_height,
+                          dst_box_x, dst_box_y, dst_box_width, dst_box_height) != 0) {
+        free(cache);
+        return NULL;
+    }
+    cache->workspace = (unsigned char*)malloc((size_t)image_resize_workspace_size(&cache->rs) * bands);
+    if (cache->workspace == NULL) {
+        image_resize_release(&cache->rs);
+        free(cache);
+        return NULL;
+    }
+    cache->workspace_bands = bands;
+    memcpy(cache->key, key, sizeof(key));
+    pp->resize_cache = cache;
+    return cache;
+}
+
+// banded CPU conversion to RGB888 or to the source format; 1: format not handled here
+static int convert_image_cpu_bands(image_preprocess_t* pp, image_buffer_t* src, image_buffer_t* dst,
+                                   int src_box_x, int src_box_y, int src_box_w, int src_box_h,
+                                   int dst_stride, int dst_box_x, int dst_box_y, int dst_box_w, int dst_box_h) {
+    int src_channel = 0;
+    int dst_channel = 0;
+    int is_yuv = src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV21;
+    if (is_yuv && dst->format != IMAGE_FORMAT_RGB888) {
+        return 1;
+    }
+    if (!is_yuv) {
+        src_channel = src->format == IMAGE_FORMAT_GRAY8 ? 1 : (src->format == IMAGE_FORMAT_RGB888 ? 3 : 4);
+        dst_channel = dst->format == IMAGE_FORMAT_GRAY8 ? 1 : (dst->format == IMAGE_FORMAT_RGB888 ? 3 : 4);
+        if (src->format != dst->format && !(src->format == IMAGE_FORMAT_RGBA8888 && dst->format == IMAGE_FORMAT_RGB888)) {
+            return 1;
+        }
+    }
+
+    int bands = pp->bands;
+    if (bands < 1) {
+        bands = 1;
+    }
+    if (bands > IMAGE_PREPROCESS_MAX_BANDS) {
+        bands = IMAGE_PREPROCESS_MAX_BANDS;
+    }
+    if (bands > dst_box_h) {
+        bands = dst_box_h;
+    }
+
+    cpu_band_job_t job;
+    memset(&job, 0, sizeof(job));
+    if (!is_yuv) {
+        image_resize_cache_t* cache = get_resize_cache(pp, src_channel, dst_channel, src->width, src->height,
+            src_box_x, src_box_y, src_box_w, src_box_h, dst_box_x, dst_box_y, dst_box_w, dst_box_h, bands);
+        if (cache == NULL) {
+            return -1;
+        }
+        job.rs = &cache->rs;
+        job.workspace_size = image_resize_workspace_size(&cache->rs);
+        job.workspace = cache->workspace;
+    }
+    job.uv_swap = src->format == IMAGE_FORMAT_YUV420SP_NV21;
+    job.src = src->virt_addr;
+    job.src_width = src->width;
+    job.src_height = src->height;
+    job.src_stride = src->width_stride > src->width ? src->width_stride : src->width;
+    job.crop_x = src_box_x;
+    job.crop_y = src_box_y;
+    job.crop_width = src_box_w;
+    job.crop_height = src_box_h;
+    job.dst = dst->virt_addr;
+    job.dst_stride = dst_stride;
+    job.dst_box_x = dst_box_x;
+    job.dst_box_y = dst_box_y;
+    job.dst_box_width = dst_box_w;
+    job.dst_box_height = dst_box_h;
+    job.bands = bands;
+    job.band_us = pp->band_us;
+
+    thread_pool_run(pp->pool, bands, run_cpu_band, &job);
+    pp->band_count = bands;
     return 0;
 }
 
-static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rect_t *src_box, image_rect_t *dst_box, char color) {
+// rectangles of dst outside box: full-width top and bottom bands, then the left and right
+// sides of the box rows. returns the count (0-4)
+static int get_pad_rects(int width, int height, const image_rect_t* box, image_rect_t* rects)
+{
+    int n = 0;
+    if (box->top > 0) {
+        image_rect_t r = {0, 0, width - 1, box->top - 1};
+        rects[n++] = r;
+    }
+    if (box->bottom < height - 1) {
+        image_rect_t r = {0, box->bottom + 1, width - 1, height - 1};
+        rects[n++] = r;
+    }
+    if (box->left > 0) {
+        image_rect_t r = {0, box->top, box->left - 1, box->bottom};
+        rects[n++] = r;
+    }
+    if (box->right < width - 1) {
+        image_rect_t r = {box->right + 1, box->top, width - 1, box->bottom};
+        rects[n++] = r;
+    }
+    return n;
+}
+
+static void fill_plane_rect(unsigned char* plane, int pitch, int x, int y, int w, int h, char color)
+{
+    for (int i = 0; i < h; i++) {
+        memset(plane + (size_t)(y + i) * pitch + x, color, w);
+    }
+}
+
+// paint the part of dst outside dst_box
+static void fill_image_pad_cpu(image_buffer_t* dst, int dst_stride, const image_rect_t* dst_box, char color)
+{
+    image_rect_t rects[4];
+    int n = get_pad_rects(dst->width, dst->height, dst_box, rects);
+    unsigned char* base = dst->virt_addr;
+    int is_yuv = dst->format == IMAGE_FORMAT_YUV420SP_NV12 || dst->format == IMAGE_FORMAT_YUV420SP_NV21;
+    int bpp = dst->format == IMAGE_FORMAT_RGB888 ? 3 : (dst->format == IMAGE_FORMAT_RGBA8888 ? 4 : 1);
+    for (int i = 0; i < n; i++) {
+        const image_rect_t* r = &rects[i];
+        fill_plane_rect(base, dst_stride * bpp, r->left * bpp, r->top,
+            (r->right - r->left + 1) * bpp, r->bottom - r->top + 1, color);
+        if (is_yuv) {
+            // interleaved UV plane, one row per two luma rows
+            int x0 = r->left & ~1;
+            int x1 = r->right | 1;
+            fill_plane_rect(base + (size_t)dst_stride * dst->height, dst_stride, x0, r->top / 2,
+                x1 - x0 + 1, r->bottom / 2 - r->top / 2 + 1, color);
+        }
+    }
+}
+
+static int convert_image_cpu(image_preprocess_t *pp, image_buffer_t *src, image_buffer_t *dst, image_rect_t *src_box, image_rect_t *dst_box, char color, int fill_pad) {
     int ret;
     if (dst->virt_addr == NULL) {
         return -1;
@@ -342,7 +640,9 @@ static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rec
     if (src->virt_addr == NULL) {
         return -1;
     }
-    if (src->format != dst->format) {
+    // same format, or any supported format to RGB888
+    if (src->format != dst->format && dst->format != IMAGE_FORMAT_RGB888) {
+        LOGE("no support convert format %d to %d\n", src->format, dst->format);
         return -1;
     }
 
@@ -367,33 +667,64 @@ static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rec
         dst_box_h = dst_box->bottom - dst_box->top + 1;
     }
 
-    // fill pad color
-    if (dst_box_w != dst->width || dst_box_h != dst->height) {
-        int dst_size = get_image_size(dst);
-        memset(dst->virt_addr, color, dst_size);
+    // rows of dst may be padded to width_stride pixels
+    int dst_stride = dst->width_stride > dst->width ? dst->width_stride : dst->width;
+
+    // fill pad color, the box itself is overwritten by the resize
+    if (fill_pad && (dst_box_w != dst->width || dst_box_h != dst->height)) {
+        image_rect_t box = {dst_box_x, dst_box_y, dst_box_x + dst_box_w - 1, dst_box_y + dst_box_h - 1};
+        fill_image_pad_cpu(dst, dst_stride, &box, color);
     }
 
     int need_release_dst_buffer = 0;
     int reti = 0;
-    if (src->format == IMAGE_FORMAT_RGB888) {
+    if (pp != NULL) {
+        reti = convert_image_cpu_bands(pp, src, dst, src_box_x, src_box_y, src_box_w, src_box_h,
+            dst_stride, dst_box_x, dst_box_y, dst_box_w, dst_box_h);
+        if (reti <= 0) {
+            if (reti != 0) {
+                LOGE("convert_image_cpu fail %d\n", reti);
+                return -1;
+            }
+            return 0;
+        }
+        reti = 0;
+    }
+    if (src->format == IMAGE_FORMAT_RGBA8888 && dst->format == IMAGE_FORMAT_RGB888) {
+        reti = crop_and_scale_image_rgba_to_rgb(src->virt_addr, src->width, src->height,
+            src_box_x, src_box_y, src_box_w, src_box_h,
+            dst->virt_addr, dst_stride, dst->height,
+            dst_box_x, dst_box_y, dst_box_w, dst_box_h);
+    } else if ((src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV21) &&
+               dst->format == IMAGE_FORMAT_RGB888) {
+        reti = crop_and_scale_image_yuv420sp_to_rgb(src->format == IMAGE_FORMAT_YUV420SP_NV21,
+            src->virt_addr, src->width, src->height,
+            src->width_stride > src->width ? src->width_stride : src->width,
+            src_box_x, src_box_y, src_box_w, src_box_h,
+            dst->virt_addr, dst_stride, dst->height,
+            dst_box_x, dst_box_y, dst_box_w, dst_box_h);
+    } else if (src->format != dst->format) {
+        LOGE("no support convert format %d to %d\n", src->format, dst->format);
+        reti = -1;
+    } else if (src->format == IMAGE_FORMAT_RGB888) {
         reti = crop_and_scale_image_c(3, src->virt_addr, src->width, src->height,
             src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
+            dst->virt_addr, dst_stride, dst->height,
             dst_box_x, dst_box_y, dst_box_w, dst_box_h);
     } else if (src->format == IMAGE_FORMAT_RGBA8888) {
         reti = crop_and_scale_image_c(4, src->virt_addr, src->width, src->height,
             src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
+            dst->virt_addr, dst_stride, dst->height,
             dst_box_x, dst_box_y, dst_box_w, dst_box_h);
     } else if (src->format == IMAGE_FORMAT_GRAY8) {
         reti = crop_and_scale_image_c(1, src->virt_addr, src->width, src->height,
             src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
+            dst->virt_addr, dst_stride, dst->height,
             dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    } else if (src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV12) {
+    } else if (src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV21) {
         reti = crop_and_scale_image_yuv420sp(src->virt_addr, src->width, src->height,
             src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
+            dst->virt_addr, dst_stride, dst->height,
             dst_box_x, dst_box_y, dst_box_w, dst_box_h);
     } else {
         LOGE("no support format %d\n", src->format);
@@ -402,7 +733,6 @@ static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rec
         LOGE("convert_image_cpu fail %d\n", reti);
         return -1;
     }
-    LOGI("finish\n");
     return 0;
 }
 
@@ -427,25 +757,141 @@ int get_image_size(image_buffer_t* image)
     if (image == NULL) {
         return 0;
     }
+    int width = image->width_stride > image->width ? image->width_stride : image->width;
     switch (image->format)
     {
     case IMAGE_FORMAT_GRAY8:
-        return image->width * image->height;
+        return width * image->height;
     case IMAGE_FORMAT_RGB888:
-        return image->width * image->height * 3;    
+        return width * image->height * 3;    
     case IMAGE_FORMAT_RGBA8888:
-        return image->width * image->height * 4;
+        return width * image->height * 4;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        return image->width * image->height * 3 / 2;
+        return width * image->height * 3 / 2;
     default:
         break;
     }
 }
 
-static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t* src_box, image_rect_t* dst_box, char color)
+int alloc_image_buffer(image_buffer_t* image)
+{
+    if (image == NULL) {
+        return -1;
+    }
+    int size = get_image_size(image);
+    void* buf = NULL;
+    if (size <= 0 || posix_memalign(&buf, IMAGE_BUFFER_ALIGN, size) != 0) {
+        LOGE("alloc image buffer size %d error\n", size);
+        return -1;
+    }
+    image->virt_addr = (unsigned char*)buf;
+    image->size = size;
+    return 0;
+}
+
+void free_image_buffer(image_buffer_t* image)
+{
+    if (image != NULL && image->virt_addr != NULL) {
+        free(image->virt_addr);
+        image->virt_addr = NULL;
+        image->size = 0;
+    }
+}
+
+#define IMAGE_RGA_CACHE_SRC 4
+
+typedef struct {
+    void* addr;
+    int fd;
+    int width;
+    int height;
+    int format;
+    rga_buffer_handle_t handle;     // 0: empty
+    unsigned int last_use;
+} rga_cached_handle_t;
+
+// handles imported for the recent fd-backed source buffers and the target buffer. A source
+// known only by its virtual address is imported per call: the caller may free it (a
+// Bitmap unlocked after detect()) and a later buffer may land at the same address.
+struct image_rga_cache {
+    rga_cached_handle_t src[IMAGE_RGA_CACHE_SRC];
+    rga_cached_handle_t dst;
+    unsigned int clock;
+};
+typedef struct image_rga_cache image_rga_cache_t;
+
+static void drop_rga_handle(rga_cached_handle_t* entry)
+{
+    if (entry->handle > 0) {
+        releasebuffer_handle(entry->handle);
+    }
+    memset(entry, 0, sizeof(rga_cached_handle_t));
+}
+
+static rga_buffer_handle_t import_rga_handle(void* addr, int fd, im_handle_param_t* param)
+{
+    if (fd > 0) {
+        return importbuffer_fd(fd, param);
+    }
+    return importbuffer_virtualaddr(addr, param);
+}
+
+// handle of a buffer from entries[0, count), imported on a miss into the least recently used
+// entry. a new size or format drops every entry, the old buffers are not coming back.
+static rga_buffer_handle_t get_rga_handle(image_rga_cache_t* cache, rga_cached_handle_t* entries, int count,
+                                          void* addr, int fd, im_handle_param_t* param)
+{
+    rga_cached_handle_t* victim = &entries[0];
+    cache->clock++;
+    for (int i = 0; i < count; i++) {
+        rga_cached_handle_t* e = &entries[i];
+        if (e->handle > 0 && (e->width != (int)param->width || e->height != (int)param->height ||
+                              e->format != (int)param->format)) {
+            for (int j = 0; j < count; j++) {
+                drop_rga_handle(&entries[j]);
+            }
+            break;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        rga_cached_handle_t* e = &entries[i];
+        if (e->handle > 0 && e->addr == addr && e->fd == fd) {
+            e->last_use = cache->clock;
+            return e->handle;
+        }
+        if (e->handle == 0 || (victim->handle > 0 && e->last_use < victim->last_use)) {
+            victim = e;
+        }
+    }
+
+    drop_rga_handle(victim);
+    rga_buffer_handle_t handle = import_rga_handle(addr, fd, param);
+    if (handle > 0) {
+        victim->addr = addr;
+        victim->fd = fd;
+        victim->width = param->width;
+        victim->height = param->height;
+        victim->format = param->format;
+        victim->handle = handle;
+        victim->last_use = cache->clock;
+    }
+    return handle;
+}
+
+static void free_rga_cache(image_rga_cache_t* cache)
+{
+    for (int i = 0; i < IMAGE_RGA_CACHE_SRC; i++) {
+        drop_rga_handle(&cache->src[i]);
+    }
+    drop_rga_handle(&cache->dst);
+    free(cache);
+}
+
+static int convert_image_rga(image_preprocess_t* pp, image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t* src_box, image_rect_t* dst_box, char color, int fill_pad)
 {
     int ret = 0;
+    image_rga_cache_t* cache = NULL;
 
     int srcWidth = src_img->width;
     int srcHeight = src_img->height;
@@ -460,13 +906,21 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
     int dst_fd = dst_img->fd;
     void *dst_phy = NULL;
     int dstFmt = get_rga_fmt(dst_img->format);
+    int dstWstride = dst_img->width_stride > dstWidth ? dst_img->width_stride : dstWidth;
 
     int rotate = 0;
 
     int use_handle = 0;
+    int src_cached = 0;
 #if defined(LIBRGA_IM2D_HANDLE)
     use_handle = 1;
 #endif
+    if (use_handle && pp != NULL) {
+        if (pp->rga_cache == NULL) {
+            pp->rga_cache = (image_rga_cache_t*)calloc(1, sizeof(image_rga_cache_t));
+        }
+        cache = pp->rga_cache;
+    }
 
     // LOGI("src width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
     //     srcWidth, srcHeight, srcFmt, src, src_fd);
@@ -524,12 +978,15 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
     in_param.format = srcFmt;
 
     im_handle_param_t dst_param;
-    dst_param.width = dstWidth;
+    dst_param.width = dstWstride;
     dst_param.height = dstHeight;
     dst_param.format = dstFmt;
 
     if (use_handle) {
-        if (src_phy != NULL) {
+        if (cache != NULL && src_fd > 0) {
+            src_cached = 1;
+            rga_handle_src = get_rga_handle(cache, cache->src, IMAGE_RGA_CACHE_SRC, src, src_fd, &in_param);
+        } else if (src_phy != NULL) {
             rga_handle_src = importbuffer_physicaladdr((uint64_t)src_phy, &in_param);
         } else if (src_fd > 0) {
             rga_handle_src = importbuffer_fd(src_fd, &in_param);
@@ -553,7 +1010,9 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
     }
 
     if (use_handle) {
-        if (dst_phy != NULL) {
+        if (cache != NULL) {
+            rga_handle_dst = get_rga_handle(cache, &cache->dst, 1, dst, dst_fd, &dst_param);
+        } else if (dst_phy != NULL) {
             rga_handle_dst = importbuffer_physicaladdr((uint64_t)dst_phy, &dst_param);
         } else if (dst_fd > 0) {
             rga_handle_dst = importbuffer_fd(dst_fd, &dst_param);
@@ -565,32 +1024,40 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
             ret = -1;
             goto err;
         }
-        rga_buf_dst = wrapbuffer_handle(rga_handle_dst, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+        rga_buf_dst = wrapbuffer_handle(rga_handle_dst, dstWidth, dstHeight, dstFmt, dstWstride, dstHeight);
     } else {
         if (dst_phy != NULL) {
-            rga_buf_dst = wrapbuffer_physicaladdr(dst_phy, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_physicaladdr(dst_phy, dstWidth, dstHeight, dstFmt, dstWstride, dstHeight);
         } else if (dst_fd > 0) {
-            rga_buf_dst = wrapbuffer_fd(dst_fd, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_fd(dst_fd, dstWidth, dstHeight, dstFmt, dstWstride, dstHeight);
         } else {
-            rga_buf_dst = wrapbuffer_virtualaddr(dst, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_virtualaddr(dst, dstWidth, dstHeight, dstFmt, dstWstride, dstHeight);
         }
     }
 
-    if (drect.width != dstWidth || drect.height != dstHeight) {
-        im_rect dst_whole_rect = {0, 0, dstWidth, dstHeight};
+    if (fill_pad && (drect.width != dstWidth || drect.height != dstHeight)) {
+        image_rect_t box = {drect.x, drect.y, drect.x + drect.width - 1, drect.y + drect.height - 1};
+        image_rect_t rects[4];
+        int rect_num = get_pad_rects(dstWidth, dstHeight, &box, rects);
         int imcolor;
-        char* p_imcolor = &imcolor;
+        char* p_imcolor = (char*)&imcolor;
         p_imcolor[0] = color;
         p_imcolor[1] = color;
         p_imcolor[2] = color;
         p_imcolor[3] = color;
-        LOGI("fill dst image (x y w h)=(%d %d %d %d) with color=0x%x\n",
-            dst_whole_rect.x, dst_whole_rect.y, dst_whole_rect.width, dst_whole_rect.height, imcolor);
-        ret_rga = imfill(rga_buf_dst, dst_whole_rect, imcolor);
+        for (int i = 0; i < rect_num; i++) {
+            im_rect pad_rect = {rects[i].left, rects[i].top,
+                                rects[i].right - rects[i].left + 1, rects[i].bottom - rects[i].top + 1};
+            LOGI("fill dst image (x y w h)=(%d %d %d %d) with color=0x%x\n",
+                pad_rect.x, pad_rect.y, pad_rect.width, pad_rect.height, imcolor);
+            ret_rga = imfill(rga_buf_dst, pad_rect, imcolor);
+            if (ret_rga <= 0) {
+                break;
+            }
+        }
         if (ret_rga <= 0) {
             if (dst != NULL) {
-                size_t dst_size = get_image_size(dst_img);
-                memset(dst, color, dst_size);
+                fill_image_pad_cpu(dst_img, dstWstride, &box, color);
             } else {
                 LOGW("Warning: Can not fill color on target image\n");
             }
@@ -606,11 +1073,12 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
     }
 
 err:
-    if (rga_handle_src > 0) {
+    // cached handles stay imported for the next frame
+    if (rga_handle_src > 0 && !src_cached) {
         releasebuffer_handle(rga_handle_src);
     }
 
-    if (rga_handle_dst > 0) {
+    if (rga_handle_dst > 0 && cache == NULL) {
         releasebuffer_handle(rga_handle_dst);
     }
 
@@ -618,7 +1086,37 @@ err:
     return ret;
 }
 
-int convert_image(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t* src_box, image_rect_t* dst_box, char color)
+static image_rect_t whole_or_box(const image_buffer_t* img, const image_rect_t* box)
+{
+    image_rect_t r = {0, 0, img->width - 1, img->height - 1};
+    return box != NULL ? *box : r;
+}
+
+// the pad painted by the previous conversion into this buffer is still in place
+static int pad_unchanged(const image_preprocess_t* pp, const image_buffer_t* dst, const image_rect_t* dst_box, char color)
+{
+    image_rect_t box = whole_or_box(dst, dst_box);
+    return pp->pad_valid && pp->pad_addr == dst->virt_addr && pp->pad_fd == dst->fd &&
+           pp->pad_width == dst->width && pp->pad_height == dst->height &&
+           pp->pad_stride == dst->width_stride && pp->pad_format == dst->format && pp->pad_color == color &&
+           memcmp(&pp->pad_box, &box, sizeof(image_rect_t)) == 0;
+}
+
+static void remember_pad(image_preprocess_t* pp, const image_buffer_t* dst, const image_rect_t* dst_box, char color)
+{
+    pp->pad_valid = 1;
+    pp->pad_addr = dst->virt_addr;
+    pp->pad_fd = dst->fd;
+    pp->pad_width = dst->width;
+    pp->pad_height = dst->height;
+    pp->pad_stride = dst->width_stride;
+    pp->pad_format = dst->format;
+    pp->pad_color = color;
+    pp->pad_box = whole_or_box(dst, dst_box);
+}
+
+static int convert_image_internal(image_preprocess_t* pp, image_buffer_t* src_img, image_buffer_t* dst_img,
+                                  image_rect_t* src_box, image_rect_t* dst_box, char color)
 {
     int ret;
  
@@ -634,22 +1132,37 @@ int convert_image(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t
     }
     LOGI("color=0x%x\n", color);
 
-    ret = convert_image_rga(src_img, dst_img, src_box, dst_box, color);
+    int fill_pad = 1;
+    if (pp != NULL) {
+        pp->band_count = 0;
+        fill_pad = !pad_unchanged(pp, dst_img, dst_box, color);
+        pp->pad_valid = 0;
+    }
+    ret = convert_image_rga(pp, src_img, dst_img, src_box, dst_box, color, fill_pad);
     if (ret != 0) {
         LOGW("try convert image use cpu\n");
-        ret = convert_image_cpu(src_img, dst_img, src_box, dst_box, color);
+        ret = convert_image_cpu(pp, src_img, dst_img, src_box, dst_box, color, fill_pad);
+    }
+    if (ret == 0 && pp != NULL) {
+        remember_pad(pp, dst_img, dst_box, color);
     }
     return ret;
 }
 
+int convert_image(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t* src_box, image_rect_t* dst_box, char color)
+{
+    return convert_image_internal(NULL, src_img, dst_img, src_box, dst_box, color);
+}
+
 int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_t* letterbox, char color)
 {
-    int ret = 0;
+    return convert_image_with_letterbox_ctx(NULL, src_image, dst_image, letterbox, color);
+}
+
+// scale the source into dst_w x dst_h keeping its aspect, centered in the target
+void compute_letterbox(int src_w, int src_h, int dst_w, int dst_h, image_rect_t* dst_box, letterbox_t* letterbox)
+{
     int allow_slight_change = 1;
-    int src_w = src_image->width;
-    int src_h = src_image->height;
-    int dst_w = dst_image->width;
-    int dst_h = dst_image->height;
     int resize_w = dst_w;
     int resize_h = dst_h;
 
@@ -660,17 +1173,10 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
     int _top_offset = 0;
     float scale = 1.0;
 
-    image_rect_t src_box;
-    src_box.left = 0;
-    src_box.top = 0;
-    src_box.right = src_image->width - 1;
-    src_box.bottom = src_image->height - 1;
-
-    image_rect_t dst_box;
-    dst_box.left = 0;
-    dst_box.top = 0;
-    dst_box.right = dst_image->width - 1;
-    dst_box.bottom = dst_image->height - 1;
+    dst_box->left = 0;
+    dst_box->top = 0;
+    dst_box->right = dst_w - 1;
+    dst_box->bottom = dst_h - 1;
 
     float _scale_w = (float)dst_w / src_w;
     float _scale_h = (float)dst_h / src_h;
@@ -693,35 +1199,71 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
     padding_w = dst_w - resize_w;
     // center
     if (_scale_w < _scale_h) {
-        dst_box.top = padding_h / 2;
-        if (dst_box.top % 2 != 0) {
-            dst_box.top -= dst_box.top % 2;
-            if (dst_box.top < 0) {
-                dst_box.top = 0;
+        dst_box->top = padding_h / 2;
+        if (dst_box->top % 2 != 0) {
+            dst_box->top -= dst_box->top % 2;
+            if (dst_box->top < 0) {
+                dst_box->top = 0;
             }
         }
-        dst_box.bottom = dst_box.top + resize_h - 1;
-        _top_offset = dst_box.top;
+        dst_box->bottom = dst_box->top + resize_h - 1;
+        _top_offset = dst_box->top;
     } else {
-        dst_box.left = padding_w / 2;
-        if (dst_box.left % 2 != 0) {
-            dst_box.left -= dst_box.left % 2;
-            if (dst_box.left < 0) {
-                dst_box.left = 0;
+        dst_box->left = padding_w / 2;
+        if (dst_box->left % 2 != 0) {
+            dst_box->left -= dst_box->left % 2;
+            if (dst_box->left < 0) {
+                dst_box->left = 0;
             }
         }
-        dst_box.right = dst_box.left + resize_w - 1;
-        _left_offset = dst_box.left;
+        dst_box->right = dst_box->left + resize_w - 1;
+        _left_offset = dst_box->left;
     }
     LOGI("scale=%f dst_box=(%d %d %d %d) allow_slight_change=%d _left_offset=%d _top_offset=%d padding_w=%d padding_h=%d\n",
-        scale, dst_box.left, dst_box.top, dst_box.right, dst_box.bottom, allow_slight_change,
+        scale, dst_box->left, dst_box->top, dst_box->right, dst_box->bottom, allow_slight_change,
         _left_offset, _top_offset, padding_w, padding_h);
 
+    letterbox->scale = scale;
+    letterbox->x_pad = _left_offset;
+    letterbox->y_pad = _top_offset;
+}
+
+int convert_image_with_letterbox_ctx(image_preprocess_t* pp, image_buffer_t* src_image, image_buffer_t* dst_image,
+                                     letterbox_t* letterbox, char color)
+{
+    int ret = 0;
+    image_rect_t src_box;
+    src_box.left = 0;
+    src_box.top = 0;
+    src_box.right = src_image->width - 1;
+    src_box.bottom = src_image->height - 1;
+
+    image_rect_t dst_box;
+    letterbox_t lb;
+    if (pp != NULL && pp->lb_valid && pp->lb_src_width == src_image->width && pp->lb_src_height == src_image->height &&
+        pp->lb_dst_width == dst_image->width && pp->lb_dst_height == dst_image->height) {
+        dst_box = pp->lb_box;
+        lb.scale = pp->lb_scale;
+        lb.x_pad = pp->lb_x_pad;
+        lb.y_pad = pp->lb_y_pad;
+    } else {
+        compute_letterbox(src_image->width, src_image->height, dst_image->width, dst_image->height, &dst_box, &lb);
+        if (pp != NULL) {
+            pp->lb_valid = 1;
+            pp->lb_src_width = src_image->width;
+            pp->lb_src_height = src_image->height;
+            pp->lb_dst_width = dst_image->width;
+            pp->lb_dst_height = dst_image->height;
+            pp->lb_box = dst_box;
+            pp->lb_scale = lb.scale;
+            pp->lb_x_pad = lb.x_pad;
+            pp->lb_y_pad = lb.y_pad;
+        }
+    }
+
     //set offset and scale
     if(letterbox != NULL){
-        letterbox->scale = scale;
-        letterbox->x_pad = _left_offset;
-        letterbox->y_pad = _top_offset;
+        *letterbox = lb;
     }
     // alloc memory buffer for dst image,
     // remember to free
@@ -733,6 +1275,36 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
             return -1;
         }
     }
-    ret = convert_image(src_image, dst_image, &src_box, &dst_box, color);
+    ret = convert_image_internal(pp, src_image, dst_image, &src_box, &dst_box, color);
     return ret;
-}
\ No newline at end of file
+}
+
+void dump_preprocess_timing(const image_preprocess_t* pp)
+{
+    if (pp == NULL || pp->band_count == 0) {
+        return;
+    }
+    char line[IMAGE_PREPROCESS_MAX_BANDS * 12 + 1];
+    int len = 0;
+    for (int i = 0; i < pp->band_count; i++) {
+        len += snprintf(line + len, sizeof(line) - len, " %lld", (long long)pp->band_us[i]);
+    }
+    LOGI("cpu letterbox %d bands (us):%s\n", pp->band_count, line);
+}
+
+void release_preprocess_cache(image_preprocess_t* pp)
+{
+    if (pp == NULL) {
+        return;
+    }
+    if (pp->resize_cache != NULL) {
+        free_resize_cache(pp->resize_cache);
+        pp->resize_cache = NULL;
+    }
+    if (pp->rga_cache != NULL) {
+        free_rga_cache(pp->rga_cache);
+        pp->rga_cache = NULL;
+    }
+    pp->lb_valid = 0;
+    pp->pad_valid = 0;
+}
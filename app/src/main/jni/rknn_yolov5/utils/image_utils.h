@@ -7,6 +7,9 @@ extern "C" {
 
 #include "common.h"
 
+// cache line size, alignment of buffers allocated by alloc_image_buffer
+#define IMAGE_BUFFER_ALIGN 64
+
 /**
  * @brief LetterBox
  * 
@@ -58,11 +61,57 @@ int convert_image(image_buffer_t* src_image, image_buffer_t* dst_image, image_re
  */
 int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_t* letterbox, char color);
 
+/**
+ * @brief Allocate the pixel buffer of an image, aligned to IMAGE_BUFFER_ALIGN bytes
+ *
+ * @param image [in/out] Image with width, height and format set, virt_addr and size are filled
+ * @return int 0: success; -1: error
+ */
+int alloc_image_buffer(image_buffer_t* image);
+
+/**
+ * @brief Free the pixel buffer allocated by alloc_image_buffer
+ *
+ * @param image [in/out] Image
+ */
+void free_image_buffer(image_buffer_t* image);
+
+/**
+ * @brief Convert image with letterbox, splitting the CPU fallback into pp->bands
+ *        horizontal bands of the target box run on pp->pool
+ * 
+ * @param pp [in/out] Preprocess state, per-band times are stored in it; NULL for convert_image_with_letterbox.
+ *                    The pad is not repainted while dst_image, its geometry and color stay the same.
+ * @param src_image [in] Source Image
+ * @param dst_image [out] Target Image
+ * @param letterbox [out] Letterbox
+ * @param color [in] Fill color on target image
+ * @return int 
+ */
+int convert_image_with_letterbox_ctx(image_preprocess_t* pp, image_buffer_t* src_image, image_buffer_t* dst_image,
+                                     letterbox_t* letterbox, char color);
+
+/**
+ * @brief Free the resize tables and RGA handles cached in the preprocess state.
+ *        Call it before a source buffer that went through the state is freed,
+ *        as an imported RGA handle would otherwise outlive its memory
+ *
+ * @param pp [in/out] Preprocess state
+ */
+void release_preprocess_cache(image_preprocess_t* pp);
+
+/**
+ * @brief Log the per-band times of the last CPU letterbox
+ * 
+ * @param pp [in] Preprocess state
+ */
+void dump_preprocess_timing(const image_preprocess_t* pp);
+
 /**
  * @brief Get the image size
  * 
  * @param image [in] Image
- * @return int image size
+ * @return int image size in bytes, rows padded to width_stride when it is set
  */
 int get_image_size(image_buffer_t* image);
 
@@ -0,0 +1,42 @@
+#ifndef _RKNN_MODEL_ZOO_IMAGE_UTILS_INTERNAL_H_
+#define _RKNN_MODEL_ZOO_IMAGE_UTILS_INTERNAL_H_
+
+// CPU kernels behind convert_image(), exposed for the host benchmarks only.
+// dst_width is the row pitch of dst in pixels, it may exceed the image width.
+
+#include "image_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int crop_and_scale_image_c(int channel, unsigned char *src, int src_width, int src_height,
+                           int crop_x, int crop_y, int crop_width, int crop_height,
+                           unsigned char *dst, int dst_width, int dst_height,
+                           int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height);
+
+int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int src_height,
+                                  int crop_x, int crop_y, int crop_width, int crop_height,
+                                  unsigned char *dst, int dst_width, int dst_height,
+                                  int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height);
+
+int crop_and_scale_image_rgba_to_rgb(unsigned char *src, int src_width, int src_height,
+                                     int crop_x, int crop_y, int crop_width, int crop_height,
+                                     unsigned char *dst, int dst_width, int dst_height,
+                                     int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height);
+
+// uv_swap: 0 for NV12 (UV order), 1 for NV21 (VU order); src_stride: row bytes of the Y and UV planes
+int crop_and_scale_image_yuv420sp_to_rgb(int uv_swap, unsigned char *src, int src_width, int src_height,
+                                         int src_stride, int crop_x, int crop_y, int crop_width, int crop_height,
+                                         unsigned char *dst, int dst_width, int dst_height,
+                                         int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height);
+
+// letterbox geometry of convert_image_with_letterbox(): dst_box is where the scaled source
+// lands in the dst_w x dst_h target, sizes and offsets aligned down as it does
+void compute_letterbox(int src_w, int src_h, int dst_w, int dst_h, image_rect_t *dst_box, letterbox_t *letterbox);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif // _RKNN_MODEL_ZOO_IMAGE_UTILS_INTERNAL_H_
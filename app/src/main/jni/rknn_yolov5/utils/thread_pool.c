@@ -0,0 +1,148 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+#include "common.h"
+
+struct thread_pool {
+    pthread_t* threads;
+    int num_workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;   // a new batch is posted, or stop
+    pthread_cond_t done_cond;   // the last worker left the batch
+    unsigned int generation;
+    int stop;
+
+    // current batch
+    thread_pool_task_fn fn;
+    void* arg;
+    int count;
+    int next;                   // next task index, taken atomically
+    int busy;                   // workers still inside the batch
+};
+
+// take tasks of the current batch until none is left
+static void run_tasks(thread_pool_t* pool) {
+    for (;;) {
+        int index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (index >= pool->count) {
+            break;
+        }
+        pool->fn(pool->arg, index);
+    }
+}
+
+static void* worker_main(void* param) {
+    thread_pool_t* pool = (thread_pool_t*)param;
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_tasks(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+thread_pool_t* thread_pool_create(int num_threads) {
+    if (num_threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cores > 0 && cores < THREAD_POOL_DEFAULT_THREADS ? (int)cores : THREAD_POOL_DEFAULT_THREADS;
+    }
+
+    thread_pool_t* pool = (thread_pool_t*)calloc(1, sizeof(thread_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    // the caller of thread_pool_run is one of the threads
+    int num_workers = num_threads - 1;
+    if (num_workers > 0) {
+        pool->threads = (pthread_t*)calloc(num_workers, sizeof(pthread_t));
+        if (pool->threads == NULL) {
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+            LOGE("create worker thread %d fail!\n", i);
+            break;
+        }
+        pool->num_workers++;
+    }
+    LOGI("thread pool: %d threads\n", pool->num_workers + 1);
+    return pool;
+}
+
+void thread_pool_destroy(thread_pool_t* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+int thread_pool_size(const thread_pool_t* pool) {
+    return pool != NULL ? pool->num_workers + 1 : 1;
+}
+
+void thread_pool_run(thread_pool_t* pool, int count, thread_pool_task_fn fn, void* arg) {
+    if (count <= 0) {
+        return;
+    }
+    if (pool == NULL || pool->num_workers == 0 || count == 1) {
+        for (int i = 0; i < count; i++) {
+            fn(arg, i);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->count = count;
+    pool->next = 0;
+    pool->busy = pool->num_workers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_tasks(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,60 @@
+#ifndef _RKNN_MODEL_ZOO_THREAD_POOL_H_
+#define _RKNN_MODEL_ZOO_THREAD_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// thread count used by thread_pool_create(0), capped by the online cores
+#define THREAD_POOL_DEFAULT_THREADS 4
+
+typedef struct thread_pool thread_pool_t;
+
+/**
+ * @brief Task of thread_pool_run
+ *
+ * @param arg [in] Argument passed to thread_pool_run
+ * @param index [in] Task index in [0, count)
+ */
+typedef void (*thread_pool_task_fn)(void* arg, int index);
+
+/**
+ * @brief Start a pool of persistent worker threads
+ *
+ * @param num_threads [in] Threads running tasks, the caller of thread_pool_run included;
+ *                         <= 0 for min(online cores, THREAD_POOL_DEFAULT_THREADS)
+ * @return thread_pool_t* pool; NULL: error
+ */
+thread_pool_t* thread_pool_create(int num_threads);
+
+/**
+ * @brief Stop and join the workers
+ *
+ * @param pool [in] Pool
+ */
+void thread_pool_destroy(thread_pool_t* pool);
+
+/**
+ * @brief Threads running tasks, the calling thread included
+ *
+ * @param pool [in] Pool, NULL counts as 1
+ * @return int thread count
+ */
+int thread_pool_size(const thread_pool_t* pool);
+
+/**
+ * @brief Run fn(arg, 0) .. fn(arg, count - 1) on the pool and the calling thread, return when all are done.
+ *        Calls on one pool must not overlap.
+ *
+ * @param pool [in] Pool, NULL runs the tasks on the calling thread
+ * @param count [in] Task count
+ * @param fn [in] Task
+ * @param arg [in] Argument of fn
+ */
+void thread_pool_run(thread_pool_t* pool, int count, thread_pool_task_fn fn, void* arg);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif // _RKNN_MODEL_ZOO_THREAD_POOL_H_
@@ -21,6 +21,9 @@
 #include "utils/common.h"
 #include "utils/file_utils.h"
 #include "utils/image_utils.h"
+#include "utils/thread_pool.h"
+#include "tensor_record.h"
+#include "decode_config.h"
 
 //#define PERF_DETAIL
 
@@ -100,6 +103,16 @@ int init_yolov5_model(const char *model_path, rknn_app_context_t *app_ctx) {
         dump_tensor_attr(&(output_attrs[i]));
     }
 
+    // anchors, strides, output order, ... shipped with the model, compiled into the decode tables below
+    decode_config_t *config = (decode_config_t *) malloc(sizeof(decode_config_t));
+    if (config == NULL || load_decode_config(ctx, model_path, config) != 0 ||
+        reorder_output_attrs(config, output_attrs, io_num.n_output) != 0) {
+        LOGE("load decode config fail!\n");
+        free(config);
+        return -1;
+    }
+    app_ctx->decode_config = config;
+
     // Set to context
     app_ctx->rknn_ctx = ctx;
 
@@ -131,10 +144,43 @@ int init_yolov5_model(const char *model_path, rknn_app_context_t *app_ctx) {
     LOGI("model input height=%d, width=%d, channel=%d\n",
          app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    // letterbox destination, reused by every inference
+    memset(&app_ctx->input_image, 0, sizeof(image_buffer_t));
+    app_ctx->input_image.width = app_ctx->model_width;
+    app_ctx->input_image.height = app_ctx->model_height;
+    app_ctx->input_image.format = IMAGE_FORMAT_RGB888;
+    if (alloc_image_buffer(&app_ctx->input_image) != 0) {
+        LOGE("alloc input image fail!\n");
+        return -1;
+    }
+
+    // CPU letterbox bands run on a pool kept for the model lifetime
+    app_ctx->pool = thread_pool_create(0);
+    memset(&app_ctx->preprocess, 0, sizeof(image_preprocess_t));
+    app_ctx->preprocess.pool = app_ctx->pool;
+    app_ctx->preprocess.bands = thread_pool_size(app_ctx->pool);
+
+    // per-head decode tables, reused by every post_process
+    ret = init_yolov5_decode(app_ctx);
+    if (ret != 0) {
+        LOGE("init_yolov5_decode fail! ret=%d\n", ret);
+        return -1;
+    }
+
     return 0;
 }
 
 int release_yolov5_model(rknn_app_context_t *app_ctx) {
+    tensor_record_stop(app_ctx);
+    if (app_ctx->pool != NULL) {
+        thread_pool_destroy(app_ctx->pool);
+        app_ctx->pool = NULL;
+    }
+    release_preprocess_cache(&app_ctx->preprocess);
+    memset(&app_ctx->preprocess, 0, sizeof(image_preprocess_t));
+    release_yolov5_decode(app_ctx);
+    free(app_ctx->decode_config);
+    app_ctx->decode_config = NULL;
     if (app_ctx->rknn_ctx != 0) {
         // 9.销毁 RKNN
         rknn_destroy(app_ctx->rknn_ctx);
@@ -148,58 +194,47 @@ int release_yolov5_model(rknn_app_context_t *app_ctx) {
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    free_image_buffer(&app_ctx->input_image);
     return 0;
 }
 
-int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img,
+int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, const detect_options_t *opts,
                            object_detect_result_list *od_results) {
     int ret;
     int64_t start_us, elapse_us;
-    image_buffer_t dst_img;
+    image_buffer_t *dst_img = &app_ctx->input_image;
     letterbox_t letter_box;
     rknn_input inputs[app_ctx->io_num.n_input];
     rknn_output outputs[app_ctx->io_num.n_output];
     void *output_data[app_ctx->io_num.n_output];
-    const float nms_threshold = NMS_THRESH;      // 默认的NMS阈值
-    const float box_conf_threshold = BOX_THRESH; // 默认的置信度阈值
-    int bg_color = 114;
 
     if ((!app_ctx) || !(img) || (!od_results)) {
         return -1;
     }
+    int bg_color = yolov5_decode_config(app_ctx)->pad_color;
 
     memset(od_results, 0x00, sizeof(*od_results));
     memset(&letter_box, 0, sizeof(letterbox_t));
-    memset(&dst_img, 0, sizeof(image_buffer_t));
     memset(inputs, 0, sizeof(inputs));
     memset(outputs, 0, sizeof(outputs));
 
     // Pre Process
-    dst_img.width = app_ctx->model_width;
-    dst_img.height = app_ctx->model_height;
-    dst_img.format = IMAGE_FORMAT_RGB888;
-    dst_img.size = get_image_size(&dst_img);
-    dst_img.virt_addr = (unsigned char *) malloc(dst_img.size);
-    if (dst_img.virt_addr == NULL) {
-        LOGE("malloc buffer size:%d fail!\n", dst_img.size);
-        return -1;
-    }
-
     // 3.对输入进行前处理
     // letterbox操作：在对图片进行resize时，保持原图的长宽比进行等比例缩放，当长边 resize 到需要的长度时，短边剩下的部分采用灰色填充。
     // letterbox
-    ret = convert_image_with_letterbox(img, &dst_img, &letter_box, bg_color);
+    ret = convert_image_with_letterbox_ctx(&app_ctx->preprocess, img, dst_img, &letter_box, bg_color);
     if (ret < 0) {
         LOGE("convert_image_with_letterbox fail! ret=%d\n", ret);
         goto out;
     }
+    dump_preprocess_timing(&app_ctx->preprocess);
 
     // Set Input Data
     inputs[0].index = 0;
     inputs[0].type = RKNN_TENSOR_UINT8;
     inputs[0].fmt = RKNN_TENSOR_NHWC;
     inputs[0].size = app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
-    inputs[0].buf = dst_img.virt_addr;
+    inputs[0].buf = dst_img->virt_addr;
 
     // 4.设置输入数据
     ret = rknn_inputs_set(app_ctx->rknn_ctx, app_ctx->io_num.n_input, inputs);
@@ -223,8 +258,10 @@ int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img,
 
     // Get Output
     for (int i = 0; i < app_ctx->io_num.n_output; i++) {
-        outputs[i].index = i;
-        outputs[i].want_float = (!app_ctx->is_quant);
+        // the runtime output of the slot, the decode config may reorder them
+        outputs[i].index = app_ctx->output_attrs[i].index;
+        // fp16 heads are decoded as they are, other float models get float32
+        outputs[i].want_float = yolov5_output_type(app_ctx, i) == RKNN_TENSOR_FLOAT32;
     }
     // 6.获取推理结果数据
     ret = rknn_outputs_get(app_ctx->rknn_ctx, app_ctx->io_num.n_output, outputs, NULL);
@@ -248,16 +285,13 @@ int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img,
 
     // 7.对输出进行后处理
     // Post Process
-    post_process(app_ctx, output_data, &letter_box, box_conf_threshold, nms_threshold, od_results);
+    tensor_record_write(app_ctx, output_data, &letter_box);
+    post_process(app_ctx, output_data, &letter_box, opts, od_results);
 
     // 8.释放输出数据内存
     // Remeber to release rknn output
     rknn_outputs_release(app_ctx->rknn_ctx, app_ctx->io_num.n_output, outputs);
 
     out:
-    if (dst_img.virt_addr != NULL) {
-        free(dst_img.virt_addr);
-    }
-
     return ret;
 }
\ No newline at end of file
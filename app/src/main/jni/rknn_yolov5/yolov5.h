@@ -25,6 +25,16 @@ int init_yolov5_model(const char* model_path, rknn_app_context_t* app_ctx);
 
 int release_yolov5_model(rknn_app_context_t* app_ctx);
 
-int inference_yolov5_model(rknn_app_context_t* app_ctx, image_buffer_t* img, object_detect_result_list* od_results);
+/**
+ * @brief Detect the objects of one image
+ *
+ * @param app_ctx [in/out] Model context
+ * @param img [in] Source image
+ * @param opts [in] Thresholds and limits of this call, NULL for default_detect_options
+ * @param od_results [out] Detections
+ * @return int 0: success; < 0: error
+ */
+int inference_yolov5_model(rknn_app_context_t* app_ctx, image_buffer_t* img, const detect_options_t* opts,
+                           object_detect_result_list* od_results);
 
 #endif //_RKNN_DEMO_YOLOV5_H_
\ No newline at end of file
@@ -21,6 +21,9 @@
 #include "utils/common.h"
 #include "utils/file_utils.h"
 #include "utils/image_utils.h"
+#include "utils/thread_pool.h"
+#include "tensor_record.h"
+#include "decode_config.h"
 
 static void dump_tensor_attr(rknn_tensor_attr *attr) {
     LOGI("  index=%d, name=%s, n_dims=%d, dims=[%d, %d, %d, %d], n_elems=%d, size=%d, fmt=%s, type=%s, qnt_type=%s, "
@@ -31,6 +34,28 @@ static void dump_tensor_attr(rknn_tensor_attr *attr) {
          get_qnt_type_string(attr->qnt_type), attr->zp, attr->scale);
 }
 
+// Ask for NHWC int8 outputs unless NCHW is requested: the cells of an NHWC head are
+// contiguous for the decoder and the runtime skips the NCHW transpose. Float outputs are
+// converted by the runtime anyway and stay in the model layout unless NHWC is requested.
+static void request_output_layout(rknn_context ctx, int layout, rknn_tensor_attr *attr) {
+    if (layout == ZEROCOPY_OUTPUT_NCHW || attr->fmt == RKNN_TENSOR_NHWC ||
+        (layout == ZEROCOPY_OUTPUT_AUTO && attr->type != RKNN_TENSOR_INT8)) {
+        return;
+    }
+    rknn_tensor_attr nhwc_attr;
+    memset(&nhwc_attr, 0, sizeof(nhwc_attr));
+    nhwc_attr.index = attr->index;
+    int ret = rknn_query(ctx, RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR, &nhwc_attr, sizeof(rknn_tensor_attr));
+    // the decoder reads unpadded cells
+    if (ret != RKNN_SUCC || nhwc_attr.fmt != RKNN_TENSOR_NHWC || nhwc_attr.size_with_stride != nhwc_attr.size) {
+        LOGI("output %d: keep %s output, no unpadded NHWC one\n", attr->index, get_format_string(attr->fmt));
+        return;
+    }
+    LOGI("output %d: request NHWC output\n", attr->index);
+    dump_tensor_attr(&nhwc_attr);
+    *attr = nhwc_attr;
+}
+
 int init_yolov5_model_zerocopy(const char *model_path, rknn_app_context_t *app_ctx) {
     int ret;
     int model_len = 0;
@@ -89,6 +114,16 @@ int init_yolov5_model_zerocopy(const char *model_path, rknn_app_context_t *app_c
         dump_tensor_attr(&(output_attrs[i]));
     }
 
+    // anchors, strides, output order, ... shipped with the model, compiled into the decode tables below
+    decode_config_t *config = (decode_config_t *) malloc(sizeof(decode_config_t));
+    if (config == NULL || load_decode_config(ctx, model_path, config) != 0 ||
+        reorder_output_attrs(config, output_attrs, io_num.n_output) != 0) {
+        LOGE("load decode config fail!");
+        free(config);
+        return -1;
+    }
+    app_ctx->decode_config = config;
+
     rknn_tensor_mem *input_mems[io_num.n_input];
     rknn_tensor_mem *output_mems[io_num.n_output];
 
@@ -119,12 +154,23 @@ int init_yolov5_model_zerocopy(const char *model_path, rknn_app_context_t *app_c
         rknn_set_io_mem(ctx, input_mems[i], &input_attrs[i]);
     }
 
+    // NHWC outputs only when the decoder of these heads reads them
+    int output_layout = app_ctx->output_layout;
+    const head_decoder_t *decoder = find_head_decoder(&io_num, output_attrs);
+    if (decoder != NULL && !decoder->nhwc && output_layout != ZEROCOPY_OUTPUT_NCHW) {
+        LOGI("%s heads are decoded NCHW, keep the model layout\n", decoder->name);
+        output_layout = ZEROCOPY_OUTPUT_NCHW;
+    }
+
     int output_size;
     // 4.2 Set outputs memory
     for (int i = 0; i < io_num.n_output; i++) {
         // 4.2.1 Update input attrs
+        request_output_layout(ctx, output_layout, &output_attrs[i]);
+        // fp16 heads stay fp16, post_process decodes them without a float32 copy
         if (output_attrs[i].type == RKNN_TENSOR_FLOAT16) {
-            output_attrs[i].type = RKNN_TENSOR_FLOAT32;
+            output_size = output_attrs[i].n_elems * sizeof(uint16_t);
+        } else if (output_attrs[i].type == RKNN_TENSOR_FLOAT32) {
             output_size = output_attrs[i].n_elems * sizeof(float);
         } else {
             output_attrs[i].type = RKNN_TENSOR_INT8;
@@ -175,10 +221,44 @@ int init_yolov5_model_zerocopy(const char *model_path, rknn_app_context_t *app_c
     LOGI("model input height=%d, width=%d, channel=%d",
          app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    // letterbox straight into the input tensor memory: RGA writes through its fd,
+    // the CPU path through virt_addr with rows padded to w_stride
+    memset(&app_ctx->input_image, 0, sizeof(image_buffer_t));
+    app_ctx->input_image.width = app_ctx->model_width;
+    app_ctx->input_image.height = app_ctx->model_height;
+    app_ctx->input_image.width_stride = input_attrs[0].w_stride;
+    app_ctx->input_image.format = IMAGE_FORMAT_RGB888;
+    app_ctx->input_image.virt_addr = (unsigned char *) input_mems[0]->virt_addr;
+    app_ctx->input_image.size = input_mems[0]->size;
+    app_ctx->input_image.fd = input_mems[0]->fd;
+
+    // CPU letterbox bands run on a pool kept for the model lifetime
+    app_ctx->pool = thread_pool_create(0);
+    memset(&app_ctx->preprocess, 0, sizeof(image_preprocess_t));
+    app_ctx->preprocess.pool = app_ctx->pool;
+    app_ctx->preprocess.bands = thread_pool_size(app_ctx->pool);
+
+    // per-head decode tables, reused by every post_process
+    ret = init_yolov5_decode(app_ctx);
+    if (ret != 0) {
+        LOGE("init_yolov5_decode fail! ret=%d\n", ret);
+        return -1;
+    }
+
     return 0;
 }
 
 int release_yolov5_model_zerocopy(rknn_app_context_t *app_ctx) {
+    tensor_record_stop(app_ctx);
+    if (app_ctx->pool != NULL) {
+        thread_pool_destroy(app_ctx->pool);
+        app_ctx->pool = NULL;
+    }
+    release_preprocess_cache(&app_ctx->preprocess);
+    memset(&app_ctx->preprocess, 0, sizeof(image_preprocess_t));
+    release_yolov5_decode(app_ctx);
+    free(app_ctx->decode_config);
+    app_ctx->decode_config = NULL;
     if (app_ctx->rknn_ctx != 0) {
         // 9.销毁 RKNN
         rknn_destroy(app_ctx->rknn_ctx);
@@ -192,6 +272,8 @@ int release_yolov5_model_zerocopy(rknn_app_context_t *app_ctx) {
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    // input_image aliases input_mems[0], nothing to free
+    memset(&app_ctx->input_image, 0, sizeof(image_buffer_t));
     if (app_ctx->input_mems != NULL) {
         for (int i = 0; i < app_ctx->io_num.n_input; i++) {
             rknn_destroy_mem(app_ctx->rknn_ctx, app_ctx->input_mems[i]);
@@ -209,76 +291,31 @@ int release_yolov5_model_zerocopy(rknn_app_context_t *app_ctx) {
     return 0;
 }
 
-static void copyDataToTensorMemory(uint8_t *data, rknn_tensor_mem *tensor_mem,
-                                   rknn_tensor_attr *tensor_attr) {
-    // Copy data to tensor memory
-    int width = tensor_attr->dims[2];
-    int stride = tensor_attr->w_stride;
-
-    if (width == stride) {
-        memcpy(tensor_mem->virt_addr, data,
-               width * tensor_attr->dims[1] * tensor_attr->dims[3]);
-    } else {
-        int height = tensor_attr->dims[1];
-        int channel = tensor_attr->dims[3];
-        // copy from src to dst with stride
-        uint8_t *src_ptr = data;
-        uint8_t *dst_ptr = (uint8_t *) tensor_mem->virt_addr;
-        // width-channel elements
-        int src_wc_elems = width * channel;
-        int dst_wc_elems = stride * channel;
-        for (int h = 0; h < height; ++h) {
-            memcpy(dst_ptr, src_ptr, src_wc_elems);
-            src_ptr += src_wc_elems;
-            dst_ptr += dst_wc_elems;
-        }
-    }
-}
-
 int inference_yolov5_model_zerocopy(rknn_app_context_t *app_ctx, image_buffer_t *img,
-                                    object_detect_result_list *od_results) {
+                                    const detect_options_t *opts, object_detect_result_list *od_results) {
     int ret;
     int64_t start_us, elapse_us;
-    image_buffer_t dst_img;
+    image_buffer_t *dst_img = &app_ctx->input_image;
     letterbox_t letter_box;
     void *output_data[app_ctx->io_num.n_output];
 
-    const float nms_threshold = NMS_THRESH;      // 默认的NMS阈值
-    const float box_conf_threshold = BOX_THRESH; // 默认的置信度阈值
-    int bg_color = 114;
-
     if ((!app_ctx) || !(img) || (!od_results)) {
         return -1;
     }
+    int bg_color = yolov5_decode_config(app_ctx)->pad_color;
 
     memset(od_results, 0x00, sizeof(*od_results));
     memset(&letter_box, 0, sizeof(letterbox_t));
-    memset(&dst_img, 0, sizeof(image_buffer_t));
 
     // Pre Process
-    dst_img.width = app_ctx->model_width;
-    dst_img.height = app_ctx->model_height;
-    dst_img.format = IMAGE_FORMAT_RGB888;
-    dst_img.size = get_image_size(&dst_img);
-    dst_img.virt_addr = (unsigned char *) malloc(dst_img.size);
-    if (dst_img.virt_addr == NULL) {
-        LOGI("malloc buffer size:%d fail!", dst_img.size);
-        return -1;
-    }
-
-    // 对输入进行前处理
+    // 对输入进行前处理，结果直接写入输入tensor内存
     // letterbox操作：在对图片进行resize时，保持原图的长宽比进行等比例缩放，当长边 resize 到需要的长度时，短边剩下的部分采用灰色填充。
-    ret = convert_image_with_letterbox(img, &dst_img, &letter_box, bg_color);
+    ret = convert_image_with_letterbox_ctx(&app_ctx->preprocess, img, dst_img, &letter_box, bg_color);
     if (ret < 0) {
         LOGI("convert_image_with_letterbox fail! ret=%d", ret);
         goto out;
     }
-
-    // 设置输入数据
-    for (int i = 0; i < app_ctx->io_num.n_input; i++) {
-        // Copy input data to input tensor memory
-        copyDataToTensorMemory(dst_img.virt_addr, app_ctx->input_mems[i], &app_ctx->input_attrs[i]);
-    }
+    dump_preprocess_timing(&app_ctx->preprocess);
 
     // 进行模型推理
     // Run
@@ -300,13 +337,10 @@ int inference_yolov5_model_zerocopy(rknn_app_context_t *app_ctx, image_buffer_t
 
     // 对输出进行后处理
     // Post Process
+    tensor_record_write(app_ctx, output_data, &letter_box);
     LOGI("post_process");
-    post_process(app_ctx, output_data, &letter_box, box_conf_threshold, nms_threshold, od_results);
+    post_process(app_ctx, output_data, &letter_box, opts, od_results);
 
     out:
-    if (dst_img.virt_addr != NULL) {
-        free(dst_img.virt_addr);
-    }
-
     return ret;
 }
\ No newline at end of file
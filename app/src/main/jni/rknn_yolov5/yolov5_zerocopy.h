@@ -19,11 +19,23 @@
 #include "utils/common.h"
 #include "postprocess.h"
 
+/**
+ * @brief Output layout init_yolov5_model_zerocopy asks the runtime for, app_ctx->output_layout
+ *
+ */
+typedef enum {
+    ZEROCOPY_OUTPUT_AUTO = 0,   // NHWC for int8 outputs, the model layout for float ones
+    ZEROCOPY_OUTPUT_NCHW,       // the model layout
+    ZEROCOPY_OUTPUT_NHWC,       // NHWC whenever the runtime has it
+} zerocopy_output_layout_t;
+
 
 int init_yolov5_model_zerocopy(const char* model_path, rknn_app_context_t* app_ctx);
 
 int release_yolov5_model_zerocopy(rknn_app_context_t* app_ctx);
 
-int inference_yolov5_model_zerocopy(rknn_app_context_t* app_ctx, image_buffer_t* img, object_detect_result_list* od_results);
+// opts: thresholds and limits of this call, NULL for default_detect_options
+int inference_yolov5_model_zerocopy(rknn_app_context_t* app_ctx, image_buffer_t* img, const detect_options_t* opts,
+                                    object_detect_result_list* od_results);
 
 #endif //_RKNN_DEMO_YOLOV5_ZERO_COPY_H_
\ No newline at end of file
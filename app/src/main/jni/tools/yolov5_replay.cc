@@ -0,0 +1,97 @@
+/*-------------------------------------------
+                Includes
+-------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "postprocess.h"
+#include "tensor_record.h"
+
+/*-------------------------------------------
+                  Main Function
+-------------------------------------------*/
+// Streams the frames of a tensor record file through post_process() and reports
+// throughput and latency percentiles of the post-process stage alone.
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 6)
+    {
+        printf("%s <record_path> [loops] [conf_threshold] [nms_threshold] [max_detections]\n", argv[0]);
+        return -1;
+    }
+
+    const char *record_path = argv[1];
+    int loops = argc > 2 ? atoi(argv[2]) : 1;
+    detect_options_t opts;
+    default_detect_options(&opts);
+    opts.conf_threshold = argc > 3 ? atof(argv[3]) : BOX_THRESH;
+    opts.nms_threshold = argc > 4 ? atof(argv[4]) : NMS_THRESH;
+    opts.max_detections = argc > 5 ? atoi(argv[5]) : OBJ_NUMB_MAX_SIZE;
+    if (loops < 1)
+    {
+        loops = 1;
+    }
+
+    rknn_app_context_t app_ctx;
+    tensor_replay_t *replay = tensor_replay_open(record_path, &app_ctx);
+    if (replay == NULL)
+    {
+        return -1;
+    }
+    printf("model %dx%d, %d outputs, %s\n", app_ctx.model_width, app_ctx.model_height,
+           app_ctx.io_num.n_output, get_type_string(yolov5_output_type(&app_ctx, 0)));
+
+    std::vector<void *> outputs(app_ctx.io_num.n_output);
+    std::vector<int64_t> latency_us;
+    object_detect_result_list od_results;
+    letterbox_t letter_box;
+    int64_t total_us = 0;
+    int64_t total_objects = 0;
+    int ret = 0;
+
+    for (int loop = 0; loop < loops && ret >= 0; loop++)
+    {
+        if (tensor_replay_rewind(replay) != 0)
+        {
+            ret = -1;
+            break;
+        }
+        while ((ret = tensor_replay_next(replay, outputs.data(), &letter_box)) > 0)
+        {
+            int64_t start_us = getCurrentTimeUs();
+            post_process(&app_ctx, outputs.data(), &letter_box, &opts, &od_results);
+            int64_t elapse_us = getCurrentTimeUs() - start_us;
+            latency_us.push_back(elapse_us);
+            total_us += elapse_us;
+            total_objects += od_results.count;
+        }
+    }
+    if (ret < 0)
+    {
+        printf("read %s fail, truncated record?\n", record_path);
+    }
+
+    tensor_replay_close(replay, &app_ctx);
+
+    if (latency_us.empty())
+    {
+        printf("no frame replayed\n");
+        return -1;
+    }
+
+    std::sort(latency_us.begin(), latency_us.end());
+    size_t n = latency_us.size();
+    printf("frames=%zu objects/frame=%.2f conf=%.2f nms=%.2f max_detections=%d\n", n,
+           (double) total_objects / n, opts.conf_threshold, opts.nms_threshold, opts.max_detections);
+    printf("post_process: %.1f frames/s, mean=%.1fus p50=%lldus p90=%lldus p99=%lldus max=%lldus\n",
+           total_us > 0 ? 1000000.0 * n / total_us : 0.0, (double) total_us / n,
+           (long long) latency_us[n / 2], (long long) latency_us[n * 90 / 100],
+           (long long) latency_us[n * 99 / 100], (long long) latency_us[n - 1]);
+
+    return 0;
+}
@@ -1,8 +1,8 @@
 #ifndef UTILBASE_H_
 #define UTILBASE_H_
 
-#include <jni.h>
 #ifdef __ANDROID__
+#include <jni.h>
 #include <android/log.h>
 #endif
 #include <unistd.h>
@@ -199,8 +199,10 @@
 			__FILE__ ":" LITERAL_TO_STRING(__LINE__)            \
 			" Should not be here.");
 
+#ifdef __ANDROID__
 void setVM(JavaVM *);
 JavaVM *getVM();
 JNIEnv *getEnv();
+#endif
 
 #endif /* UTILBASE_H_ */